@@ -268,9 +268,9 @@ void raptor(spSkeletonData *skeletonData, spAtlas *atlas) {
     drawable.timeScale = 1;
     drawable.setUsePremultipliedAlpha(true);
 
-    spSwirlVertexEffect *effect = spSwirlVertexEffect_create(400);
-    effect->centerY = -200;
-    drawable.vertexEffect = &effect->super;
+    SwirlEffect effect(400);
+    effect.centerY = -200;
+    drawable.batchVertexEffect = &effect;
 
     spSkeleton *skeleton = drawable.skeleton;
     skeleton->x = 320;
@@ -291,7 +291,7 @@ void raptor(spSkeletonData *skeletonData, spAtlas *atlas) {
             swirlTime += delta;
             float percent = (float) fmod(swirlTime, 2);
             if (percent > 1) percent = 1 - (percent - 1);
-            effect->angle = _spMath_interpolate(_spMath_pow2_apply, -60, 60, percent);
+            effect.angle = _spMath_interpolate(_spMath_pow2_apply, -60, 60, percent);
 
             drawable.update(delta);
 
@@ -304,7 +304,6 @@ void raptor(spSkeletonData *skeletonData, spAtlas *atlas) {
         while (SDL_PollEvent(&e) != 0)
             if (e.type == SDL_QUIT || e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_ESCAPE) prev_time = 0; // quit
     } while (prev_time > 0);
-    spSwirlVertexEffect_dispose(effect);
 }
 
 void tank(spSkeletonData *skeletonData, spAtlas *atlas) {
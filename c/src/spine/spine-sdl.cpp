@@ -3,11 +3,60 @@
 //
 
 #include <spine/spine-sdl.h>
+#include <float.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
 
 #ifndef SPINE_MESH_VERTEX_COUNT_MAX
 #define SPINE_MESH_VERTEX_COUNT_MAX 1000
 #endif
 
+// Vertex kernels: SSE2 and AVX2 on x86, NEON on ARM, picked at runtime. Define SPINE_SDL_NO_SIMD to build the
+// scalar ones only.
+#ifndef SPINE_SDL_NO_SIMD
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SPINE_SDL_SSE2
+#include <emmintrin.h>
+#if defined(__GNUC__) || defined(__clang__) || defined(_MSC_VER)
+#define SPINE_SDL_AVX2
+#include <immintrin.h>
+#endif
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define SPINE_SDL_NEON
+#include <arm_neon.h>
+#endif
+#endif
+
+// Files are memory-mapped where there's mmap, define SPINE_SDL_NO_MMAP to always read them into memory
+#if !defined(SPINE_SDL_NO_MMAP) && (defined(__unix__) || defined(__APPLE__))
+#define SPINE_SDL_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Scoped trace markers of the update and draw pipeline (see Trace). They compile to nothing unless SPINE_SDL_TRACE
+// is defined. Each thread keeps the last SPINE_SDL_TRACE_CAPACITY events, a power of two.
+#ifdef SPINE_SDL_TRACE
+#ifndef SPINE_SDL_TRACE_CAPACITY
+#define SPINE_SDL_TRACE_CAPACITY 65536
+#endif
+#define SPINE_SDL_TRACE_CONCAT2(a, b) a##b
+#define SPINE_SDL_TRACE_CONCAT(a, b) SPINE_SDL_TRACE_CONCAT2(a, b)
+#define SPINE_SDL_TRACE_SCOPE(name) TraceScope SPINE_SDL_TRACE_CONCAT(traceScope, __LINE__)(name)
+#else
+#define SPINE_SDL_TRACE_SCOPE(name)
+#endif
+
+#if defined(SPINE_SDL_AVX2) && (defined(__GNUC__) || defined(__clang__))
+#define SPINE_SDL_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define SPINE_SDL_TARGET_AVX2
+#endif
+
 namespace blend {
     SDL_BlendMode normal = SDL_ComposeCustomBlendMode(SDL_BLENDFACTOR_SRC_ALPHA,SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA,SDL_BLENDOPERATION_ADD,
                                                       SDL_BLENDFACTOR_SRC_ALPHA,SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA,SDL_BLENDOPERATION_ADD);
@@ -56,23 +105,70 @@ bool operator==(SDL_Vertex v1, SDL_Vertex v2) {
 }
 _SP_ARRAY_IMPLEMENT_TYPE(spVertexArray, SDL_Vertex)
 
+bool operator==(SDL_Color c1, SDL_Color c2) {
+    return c1.r == c2.r &&
+           c1.g == c2.g &&
+           c1.b == c2.b &&
+           c1.a == c2.a;
+}
+_SP_ARRAY_IMPLEMENT_TYPE(spSDLColorArray, SDL_Color)
+
+bool operator==(const spine::RenderCommand &c1, const spine::RenderCommand &c2) {
+    return c1.texture == c2.texture &&
+           c1.blendMode == c2.blendMode &&
+           c1.firstVertex == c2.firstVertex &&
+           c1.vertexCount == c2.vertexCount &&
+           c1.firstIndex == c2.firstIndex &&
+           c1.indexCount == c2.indexCount;
+}
+_SP_ARRAY_IMPLEMENT_TYPE(spRenderCommandArray, spine::RenderCommand)
+
+bool operator==(const spine::BakedVertex &v1, const spine::BakedVertex &v2) {
+    return v1.x == v2.x &&
+           v1.y == v2.y &&
+           v1.u == v2.u &&
+           v1.v == v2.v &&
+           v1.color.r == v2.color.r &&
+           v1.color.g == v2.color.g &&
+           v1.color.b == v2.color.b &&
+           v1.color.a == v2.color.a;
+}
+_SP_ARRAY_IMPLEMENT_TYPE(spBakedVertexArray, spine::BakedVertex)
+
+bool operator==(const spine::BakedFrame &f1, const spine::BakedFrame &f2) {
+    return f1.firstCommand == f2.firstCommand &&
+           f1.commandCount == f2.commandCount;
+}
+_SP_ARRAY_IMPLEMENT_TYPE(spBakedFrameArray, spine::BakedFrame)
+
 extern SDL_Renderer* spSDL_getRenderer(); // to be implemented by end users
 
+// Set while a SkeletonBundle creates its atlas, the page textures come from the bundle
+static bool loadingBundle = false;
+
+// See spine::setAtlasTextureOptions()
+static Uint32 atlasTextureOptions = 0;
+
 void _spAtlasPage_createTexture(spAtlasPage *self, const char *path) {
-    SDL_Surface* img = IMG_Load(path);
-    if (!img) {
+    if (loadingBundle) return;
+    spine::AsyncTextureLoader *loader = spine::AsyncTextureLoader::getCurrent();
+    if (loader) {
+        loader->load(self, path);
+        return;
+    }
+    Uint32 options = self->pma ? atlasTextureOptions & ~(Uint32) spine::TextureOptions_PremultiplyAlpha : atlasTextureOptions;
+    SDL_Texture* texture = spine::TextureRegistry::acquire(spSDL_getRenderer(), path, options);
+    if (!texture) {
         printf("Error loading image: %s\n", path);
         return;
     }
-    SDL_Texture* texture = SDL_CreateTextureFromSurface(spSDL_getRenderer(), img);
     self->rendererObject = texture;
-    self->width = img->w;
-    self->height = img->h;
-    SDL_FreeSurface(img);
+    SDL_QueryTexture(texture, 0, 0, &self->width, &self->height);
+    if (options & spine::TextureOptions_PremultiplyAlpha) self->pma = 1;
 }
 
 void _spAtlasPage_disposeTexture(spAtlasPage *self) {
-    if (self->rendererObject != 0) SDL_DestroyTexture((SDL_Texture*)self->rendererObject);
+    spine::TextureRegistry::release((SDL_Texture*)self->rendererObject);
 }
 
 char *_spUtil_readFile(const char *path, int *length) {
@@ -89,225 +185,3203 @@ char *_spUtil_readFile(const char *path, int *length) {
 }
 
 namespace spine {
+#ifdef SPINE_SDL_TRACE
+    struct TraceEvent {
+        const char *name;
+        Uint64 start;
+        Uint64 end;
+    };
+
+    // Only its own thread writes to a buffer, count is published after the event so Trace::write() can read it
+    struct TraceBuffer {
+        TraceEvent events[SPINE_SDL_TRACE_CAPACITY];
+        SDL_atomic_t count;
+        SDL_threadID thread;
+        TraceBuffer *next;
+    };
+
+    static TraceBuffer *traceBuffers;
+    static SDL_TLSID traceSlot;
+    static SDL_SpinLock traceSlotLock;
+
+    static TraceBuffer *getTraceBuffer() {
+        if (traceSlot == 0) {
+            SDL_AtomicLock(&traceSlotLock);
+            if (traceSlot == 0) traceSlot = SDL_TLSCreate();
+            SDL_AtomicUnlock(&traceSlotLock);
+        }
+        TraceBuffer *buffer = (TraceBuffer *) SDL_TLSGet(traceSlot);
+        if (buffer) return buffer;
+        // Never freed: a thread may record until exit, and SDL_calloc keeps them out of spine's leak reports
+        buffer = (TraceBuffer *) SDL_calloc(1, sizeof(TraceBuffer));
+        buffer->thread = SDL_ThreadID();
+        SDL_TLSSet(traceSlot, buffer, 0);
+        do {
+            buffer->next = (TraceBuffer *) SDL_AtomicGetPtr((void **) &traceBuffers);
+        } while (!SDL_AtomicCASPtr((void **) &traceBuffers, buffer->next, buffer));
+        return buffer;
+    }
+
+    class TraceScope {
+    public:
+        explicit TraceScope(const char *name) : name(name), start(SDL_GetPerformanceCounter()) {
+        }
+
+        ~TraceScope() {
+            TraceBuffer *buffer = getTraceBuffer();
+            unsigned index = (unsigned) SDL_AtomicGet(&buffer->count);
+            TraceEvent &event = buffer->events[index & (SPINE_SDL_TRACE_CAPACITY - 1)];
+            event.name = name;
+            event.start = start;
+            event.end = SDL_GetPerformanceCounter();
+            SDL_AtomicSet(&buffer->count, (int) (index + 1));
+        }
+
+    private:
+        const char *name;
+        Uint64 start;
+    };
+#endif
+
+    bool Trace::isEnabled() {
+#ifdef SPINE_SDL_TRACE
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    bool Trace::write(const char *path) {
+#ifdef SPINE_SDL_TRACE
+        SDL_RWops *file = SDL_RWFromFile(path, "wb");
+        if (!file) return false;
+        double microseconds = 1000000.0 / (double) SDL_GetPerformanceFrequency();
+        const char *header = "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+        bool ok = SDL_RWwrite(file, header, 1, SDL_strlen(header)) == SDL_strlen(header);
+        const char *separator = "\n";
+        for (TraceBuffer *buffer = (TraceBuffer *) SDL_AtomicGetPtr((void **) &traceBuffers); buffer; buffer = buffer->next) {
+            unsigned count = (unsigned) SDL_AtomicGet(&buffer->count);
+            unsigned first = count > SPINE_SDL_TRACE_CAPACITY ? count - SPINE_SDL_TRACE_CAPACITY : 0;
+            for (unsigned i = first; i != count; ++i) {
+                TraceEvent &event = buffer->events[i & (SPINE_SDL_TRACE_CAPACITY - 1)];
+                char line[256];
+                int length = SDL_snprintf(line, sizeof(line), "%s{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %lu, \"ts\": %.3f, \"dur\": %.3f}",
+                                          separator, event.name, (unsigned long) buffer->thread, event.start * microseconds,
+                                          (event.end - event.start) * microseconds);
+                ok = ok && SDL_RWwrite(file, line, 1, length) == (size_t) length;
+                separator = ",\n";
+            }
+        }
+        const char *footer = "\n]}\n";
+        ok = ok && SDL_RWwrite(file, footer, 1, SDL_strlen(footer)) == SDL_strlen(footer);
+        return SDL_RWclose(file) == 0 && ok;
+#else
+        UNUSED(path);
+        return false;
+#endif
+    }
+
+    void RenderStats::reset() {
+        drawCalls = textureChanges = blendModeChanges = clipRectChanges = 0;
+        vertices = indices = 0;
+        trianglesBeforeClipping = trianglesAfterClipping = clipCacheHits = skippedSlots = 0;
+        updateTicks = buildTicks = submitTicks = 0;
+    }
+
+    void RenderStats::add(const RenderStats &other) {
+        drawCalls += other.drawCalls;
+        textureChanges += other.textureChanges;
+        blendModeChanges += other.blendModeChanges;
+        clipRectChanges += other.clipRectChanges;
+        vertices += other.vertices;
+        indices += other.indices;
+        trianglesBeforeClipping += other.trianglesBeforeClipping;
+        trianglesAfterClipping += other.trianglesAfterClipping;
+        clipCacheHits += other.clipCacheHits;
+        skippedSlots += other.skippedSlots;
+        updateTicks += other.updateTicks;
+        buildTicks += other.buildTicks;
+        submitTicks += other.submitTicks;
+    }
+
+    double RenderStats::toMilliseconds(Uint64 ticks) {
+        return (double) ticks * 1000 / (double) SDL_GetPerformanceFrequency();
+    }
+
+    // Everything but the update time, which belongs to update()
+    static void resetDrawStats(RenderStats &stats) {
+        Uint64 updateTicks = stats.updateTicks;
+        stats.reset();
+        stats.updateTicks = updateTicks;
+    }
+
+    // What a list gained between two snapshots of its stats
+    static void setDrawStats(RenderStats &stats, const RenderStats &after, const RenderStats &before) {
+        resetDrawStats(stats);
+        stats.drawCalls = after.drawCalls - before.drawCalls;
+        stats.textureChanges = after.textureChanges - before.textureChanges;
+        stats.blendModeChanges = after.blendModeChanges - before.blendModeChanges;
+        stats.clipRectChanges = after.clipRectChanges - before.clipRectChanges;
+        stats.vertices = after.vertices - before.vertices;
+        stats.indices = after.indices - before.indices;
+        stats.trianglesBeforeClipping = after.trianglesBeforeClipping - before.trianglesBeforeClipping;
+        stats.trianglesAfterClipping = after.trianglesAfterClipping - before.trianglesAfterClipping;
+        stats.clipCacheHits = after.clipCacheHits - before.clipCacheHits;
+        stats.skippedSlots = after.skippedSlots - before.skippedSlots;
+        stats.buildTicks = after.buildTicks - before.buildTicks;
+        stats.submitTicks = after.submitTicks - before.submitTicks;
+    }
+
+    // Clipping and skipped slots are work done once, when cached or shared geometry is built, and not again when it's
+    // replayed. They move to whoever asked for the geometry.
+    static void moveGeneratedStats(RenderStats &to, RenderStats &from) {
+        to.trianglesBeforeClipping += from.trianglesBeforeClipping;
+        to.trianglesAfterClipping += from.trianglesAfterClipping;
+        to.clipCacheHits += from.clipCacheHits;
+        to.skippedSlots += from.skippedSlots;
+        from.trianglesBeforeClipping = from.trianglesAfterClipping = from.clipCacheHits = from.skippedSlots = 0;
+    }
+
+    static const SDL_FRect emptyRect = {};
+
+    static bool hasClipRect(const RenderCommand &command, const SDL_FRect *rect) {
+        if (rect == 0) return !command.clipped;
+        return command.clipped && command.clipRect.x == rect->x && command.clipRect.y == rect->y && command.clipRect.w == rect->w &&
+               command.clipRect.h == rect->h;
+    }
+
+    // The clip rect of a command moved by x, y, or 0 if it has none
+    static const SDL_FRect *translateClipRect(const RenderCommand &command, float x, float y, SDL_FRect &rect) {
+        if (!command.clipped) return 0;
+        rect = command.clipRect;
+        rect.x += x;
+        rect.y += y;
+        return &rect;
+    }
+
+    // The clip rect the application had set on the renderer, saved before the first command that changes it
+    struct RendererClipRect {
+        bool saved;
+        bool enabled;
+        SDL_Rect rect;
+    };
+
+    // Clips to rect within the application's clip rect, or restores the application's with 0. Pixels are drawn when
+    // their center is inside a triangle, so rounding the edges keeps the pixels clipping the triangles would have kept.
+    // Returns false if nothing can be drawn.
+    static bool setRendererClipRect(SDL_Renderer *renderer, const SDL_FRect *rect, RendererClipRect &original) {
+        if (!original.saved) {
+            original.saved = true;
+            original.enabled = SDL_RenderIsClipEnabled(renderer) == SDL_TRUE;
+            SDL_RenderGetClipRect(renderer, &original.rect);
+        }
+        if (rect == 0) {
+            SDL_RenderSetClipRect(renderer, original.enabled ? &original.rect : 0);
+            return true;
+        }
+        SDL_Rect pixels;
+        pixels.x = (int) SDL_floorf(rect->x + 0.5f);
+        pixels.y = (int) SDL_floorf(rect->y + 0.5f);
+        pixels.w = (int) SDL_floorf(rect->x + rect->w + 0.5f) - pixels.x;
+        pixels.h = (int) SDL_floorf(rect->y + rect->h + 0.5f) - pixels.y;
+        if (pixels.w <= 0 || pixels.h <= 0) return false;
+        if (original.enabled && !SDL_IntersectRect(&pixels, &original.rect, &pixels)) return false;
+        SDL_RenderSetClipRect(renderer, &pixels);
+        return true;
+    }
+
+    RenderCommandList::RenderCommandList() : culledCount(0), hasViewport(false) {
+        vertexArray = spVertexArray_create(SPINE_MESH_VERTEX_COUNT_MAX);
+        indexArray = spIntArray_create(SPINE_MESH_VERTEX_COUNT_MAX * 3);
+        commands = spRenderCommandArray_create(16);
+    }
+
+    RenderCommandList::~RenderCommandList() {
+        spVertexArray_dispose(vertexArray);
+        spIntArray_dispose(indexArray);
+        spRenderCommandArray_dispose(commands);
+    }
+
+    void RenderCommandList::clear() {
+        spVertexArray_clear(vertexArray);
+        spIntArray_clear(indexArray);
+        spRenderCommandArray_clear(commands);
+        culledCount = 0;
+        stats.reset();
+    }
+
+    void RenderCommandList::setViewport(const SDL_FRect *rect) {
+        hasViewport = rect != 0;
+        if (hasViewport) viewport = *rect;
+    }
+
+    int RenderCommandList::add(SDL_Texture *texture, SDL_BlendMode blendMode, int vertexCount, int indexCount, const SDL_FRect *clipRect) {
+        RenderCommand *current = commands->size > 0 ? &commands->items[commands->size - 1] : 0;
+        if (current == 0 || current->texture != texture || current->blendMode != blendMode || !hasClipRect(*current, clipRect)) {
+            if (current != 0 && current->texture != texture) stats.textureChanges++;
+            else if (current != 0 && current->blendMode != blendMode)
+                stats.blendModeChanges++;
+            else if (current != 0)
+                stats.clipRectChanges++;
+            RenderCommand command;
+            command.texture = texture;
+            command.blendMode = blendMode;
+            command.clipped = clipRect != 0;
+            command.clipRect = clipRect ? *clipRect : emptyRect;
+            command.firstVertex = vertexArray->size;
+            command.vertexCount = 0;
+            command.firstIndex = indexArray->size;
+            command.indexCount = 0;
+            spRenderCommandArray_add(commands, command);
+            current = &commands->items[commands->size - 1];
+        }
+        int offset = current->vertexCount;
+        current->vertexCount += vertexCount;
+        current->indexCount += indexCount;
+        stats.vertices += vertexCount;
+        stats.indices += indexCount;
+        spVertexArray_setSize(vertexArray, vertexArray->size + vertexCount);
+        spIntArray_setSize(indexArray, indexArray->size + indexCount);
+        return offset;
+    }
+
+    void submit(SDL_Renderer *renderer, const RenderCommandList &list, RenderStats *stats) {
+        SPINE_SDL_TRACE_SCOPE("submit");
+        Uint64 start = SDL_GetPerformanceCounter();
+        int drawCalls = 0;
+        RendererClipRect original;
+        original.saved = false;
+        const SDL_FRect *clipRect = 0;
+        bool visible = true;
+        for (int i = 0; i < list.commands->size; ++i) {
+            RenderCommand *command = &list.commands->items[i];
+            if (command->indexCount == 0) continue;
+            if (!hasClipRect(*command, clipRect)) {
+                clipRect = command->clipped ? &command->clipRect : 0;
+                visible = setRendererClipRect(renderer, clipRect, original);
+            }
+            if (!visible) continue;
+            SPINE_SDL_TRACE_SCOPE("SDL_RenderGeometry");
+            SDL_SetTextureBlendMode(command->texture, command->blendMode);
+            SDL_RenderGeometry(renderer, command->texture, list.vertexArray->items + command->firstVertex, command->vertexCount,
+                               list.indexArray->items + command->firstIndex, command->indexCount);
+            drawCalls++;
+        }
+        if (original.saved) setRendererClipRect(renderer, 0, original);
+        if (stats) {
+            stats->drawCalls += drawCalls;
+            stats->submitTicks += SDL_GetPerformanceCounter() - start;
+        }
+    }
+
+    SkeletonBatch::SkeletonBatch() : renderer(0) {
+    }
+
+    void SkeletonBatch::begin(SDL_Renderer *sdl_renderer) {
+        renderer = sdl_renderer;
+        clear();
+    }
+
+    void SkeletonBatch::end() {
+        submit(renderer, *this, &stats);
+        // The stats of the frame stay readable until the next begin()
+        RenderStats frame = stats;
+        clear();
+        stats = frame;
+    }
+
+    WorkerPool::WorkerPool(int workerCount) : threadCount(0), job(0), context(0) {
+        if (workerCount <= 0) workerCount = SDL_GetCPUCount() - 1;
+        if (workerCount < 0) workerCount = 0;
+        threads = CALLOC(SDL_Thread *, workerCount + 1);
+        queueMemory = CALLOC(char, (workerCount + 1) * sizeof(Queue) + 63);
+        queues = (Queue *) (((size_t) queueMemory + 63) & ~(size_t) 63);
+        wake = SDL_CreateSemaphore(0);
+        done = SDL_CreateSemaphore(0);
+        SDL_AtomicSet(&pending, 0);
+        SDL_AtomicSet(&nextIndex, 0);
+        SDL_AtomicSet(&quit, 0);
+        for (int i = 0; i < workerCount; ++i) {
+            // Without thread support (e.g. Emscripten without pthreads) the pool degrades to the calling thread
+            threads[i] = SDL_CreateThread(workerMain, "spine-worker", this);
+            if (!threads[i]) break;
+            threadCount++;
+        }
+    }
+
+    WorkerPool::~WorkerPool() {
+        SDL_AtomicSet(&quit, 1);
+        for (int i = 0; i < threadCount; ++i) SDL_SemPost(wake);
+        for (int i = 0; i < threadCount; ++i) SDL_WaitThread(threads[i], 0);
+        SDL_DestroySemaphore(wake);
+        SDL_DestroySemaphore(done);
+        FREE(threads);
+        FREE(queueMemory);
+    }
+
+    void WorkerPool::run(Job runJob, void *runContext, int count) {
+        if (count <= 0) return;
+        if (threadCount == 0 || count == 1) {
+            for (int i = 0; i < count; ++i) runJob(runContext, i);
+            return;
+        }
+
+        job = runJob;
+        context = runContext;
+        int participants = threadCount + 1;
+        for (int i = 0; i < participants; ++i) {
+            queues[i].begin = (int) ((Sint64) count * i / participants);
+            queues[i].end = (int) ((Sint64) count * (i + 1) / participants);
+        }
+
+        // Every wake-up is matched by exactly one decrement of pending, whichever worker picks it up
+        SDL_AtomicSet(&pending, threadCount);
+        for (int i = 0; i < threadCount; ++i) SDL_SemPost(wake);
+        work(threadCount);
+        SDL_SemWait(done);
+    }
+
+    int WorkerPool::workerMain(void *data) {
+        WorkerPool *pool = (WorkerPool *) data;
+        int self = SDL_AtomicAdd(&pool->nextIndex, 1);
+        while (true) {
+            SDL_SemWait(pool->wake);
+            if (SDL_AtomicGet(&pool->quit)) break;
+            pool->work(self);
+            if (SDL_AtomicDecRef(&pool->pending)) SDL_SemPost(pool->done);
+        }
+        return 0;
+    }
+
+    void WorkerPool::work(int self) {
+        int index;
+        while (pop(self, index) || steal(self, index)) job(context, index);
+    }
+
+    bool WorkerPool::pop(int self, int &index) {
+        Queue &queue = queues[self];
+        SDL_AtomicLock(&queue.lock);
+        bool found = queue.begin < queue.end;
+        if (found) index = queue.begin++;
+        SDL_AtomicUnlock(&queue.lock);
+        return found;
+    }
+
+    bool WorkerPool::steal(int self, int &index) {
+        int participants = threadCount + 1;
+        for (int i = 1; i < participants; ++i) {
+            Queue &victim = queues[(self + i) % participants];
+            SDL_AtomicLock(&victim.lock);
+            int remaining = victim.end - victim.begin;
+            if (remaining <= 0) {
+                SDL_AtomicUnlock(&victim.lock);
+                continue;
+            }
+            // Take the back half, the owner keeps going from the front
+            int end = victim.end;
+            int begin = end - (remaining + 1) / 2;
+            victim.end = begin;
+            SDL_AtomicUnlock(&victim.lock);
+
+            Queue &queue = queues[self];
+            SDL_AtomicLock(&queue.lock);
+            queue.begin = begin + 1;
+            queue.end = end;
+            SDL_AtomicUnlock(&queue.lock);
+            index = begin;
+            return true;
+        }
+        return false;
+    }
+
+    struct UpdateAllContext {
+        SkeletonDrawable *const *drawables;
+        float deltaTime;
+    };
+
+    static void updateJob(void *context, int index) {
+        UpdateAllContext *data = (UpdateAllContext *) context;
+        data->drawables[index]->update(data->deltaTime);
+    }
+
+    static int comparePointers(const void *a, const void *b) {
+        uintptr_t pa = (uintptr_t) *(void *const *) a;
+        uintptr_t pb = (uintptr_t) *(void *const *) b;
+        return pa < pb ? -1 : (pa > pb ? 1 : 0);
+    }
+
+    // spAnimationState_update() and spAnimationState_apply() only read the spAnimationStateData, so drawables can share one freely.
+    // What must never happen is two workers posing the same skeleton or advancing the same state.
+    static bool haveDistinctStates(SkeletonDrawable *const *drawables, int count) {
+        void **items = MALLOC(void *, count * 2);
+        for (int i = 0; i < count; ++i) {
+            items[i * 2] = drawables[i]->state;
+            items[i * 2 + 1] = drawables[i]->skeleton;
+        }
+        SDL_qsort(items, count * 2, sizeof(void *), comparePointers);
+        bool distinct = true;
+        for (int i = 1; i < count * 2 && distinct; ++i)
+            distinct = items[i] != items[i - 1];
+        FREE(items);
+        return distinct;
+    }
+
     SkeletonDrawable::SkeletonDrawable(spSkeletonData *skeletonData, spAnimationStateData *stateData)
-    : timeScale(1), vertexEffect(0), clipper(0), usePremultipliedAlpha(false)
+    : timeScale(1), vertexEffect(0), batchVertexEffect(0), clipper(0), usePremultipliedAlpha(false), hasBounds(false), culled(false), cullAttachments(false),
+      updateInterval(1), updateFrame((int) (((size_t) this >> 4) & 7)), pendingDelta(0), posed(false), interpolateBones(false),
+      poseCache(0), pose(0), poseGeneration(0), worldStale(false), useGeometryRaw(false), useGeometryCache(false),
+      generation(0), dirtyGeneration(0), cachedGeneration(0), cachedDirtyGeneration(0), cachedSignature(0),
+      cachedUploads(0), cacheValid(false), asset(0)
     {
         spBone_setYDown(true);
+        bounds.x = bounds.y = bounds.w = bounds.h = 0;
         worldVertices = MALLOC(float, SPINE_MESH_VERTEX_COUNT_MAX);
         skeleton = spSkeleton_create(skeletonData);
         tempUvs = spFloatArray_create(16);
-        tempColors = spColorArray_create(16);
-        vertexArray = spVertexArray_create(SPINE_MESH_VERTEX_COUNT_MAX);
+        tempColors = spSDLColorArray_create(16);
+        effectAdapter = new VertexEffectAdapter();
+        localBatch = new SkeletonBatch();
 
         ownsAnimationStateData = stateData == 0;
         if (ownsAnimationStateData) stateData = spAnimationStateData_create(skeletonData);
 
         state = spAnimationState_create(stateData);
 
-        clipper = spSkeletonClipping_create();
+        clipper = new SlotClipper();
+        bonesFrom = spFloatArray_create(skeleton->bonesCount * 7);
+        bonesTo = spFloatArray_create(skeleton->bonesCount * 7);
+        rawColors = spSDLColorArray_create(SPINE_MESH_VERTEX_COUNT_MAX);
+        cachedGeometry = new RenderCommandList();
     }
 
     SkeletonDrawable::~SkeletonDrawable() {
-        spVertexArray_dispose(vertexArray);
+        delete localBatch;
         FREE(worldVertices);
         if (ownsAnimationStateData) spAnimationStateData_dispose(state->data);
         spAnimationState_dispose(state);
         spSkeleton_dispose(skeleton);
-        spSkeletonClipping_dispose(clipper);
+        delete clipper;
         spFloatArray_dispose(tempUvs);
-        spColorArray_dispose(tempColors);
+        spSDLColorArray_dispose(tempColors);
+        delete effectAdapter;
+        spFloatArray_dispose(bonesFrom);
+        spFloatArray_dispose(bonesTo);
+        spSDLColorArray_dispose(rawColors);
+        delete cachedGeometry;
+        if (asset) asset->release();
     }
 
     void SkeletonDrawable::update(float deltaTime) {
-        spSkeleton_update(skeleton, deltaTime);
-        spAnimationState_update(state, deltaTime * timeScale);
-        spAnimationState_apply(state, skeleton);
-        spSkeleton_updateWorldTransform(skeleton);
+        SPINE_SDL_TRACE_SCOPE("SkeletonDrawable::update");
+        Uint64 start = SDL_GetPerformanceCounter();
+        advance(deltaTime);
+        stats.updateTicks = SDL_GetPerformanceCounter() - start;
     }
 
-    void SkeletonDrawable::draw(SDL_Renderer *renderer) const {
-        struct { SDL_Texture* texture; SDL_BlendMode blendMode; } states; // keep the syntax as close as possible to spine-sfml
-        spVertexArray_clear(vertexArray);
-        states.texture = 0;
-        unsigned short quadIndices[6] = {0, 1, 2, 2, 3, 0};
+    void SkeletonDrawable::advance(float deltaTime) {
+        // updateFrame starts at an address-derived value so drawables sharing an interval don't all pose on the same frame
+        pendingDelta += deltaTime;
+        int frame = updateFrame & (updateInterval - 1);
+        updateFrame = (updateFrame + 1) & 7;
+        if (frame != 0 && posed) {
+            if (interpolateBones && bonesTo->size > 0) {
+                SPINE_SDL_TRACE_SCOPE("spSkeleton_updateWorldTransform");
+                blendBones((float) (frame + 1) / updateInterval);
+                spSkeleton_updateWorldTransform(skeleton);
+                pose = 0;
+                worldStale = false;
+                ++generation;
+            }
+            return;
+        }
 
-        // Early out if skeleton is invisible
-        if (skeleton->color.a == 0) return;
+        // Animations are applied on top of the latest pose, never on a blended one, so mixing is the same at any rate
+        bool blend = interpolateBones && posed;
+        if (blend) {
+            if (bonesTo->size > 0) blendBones(1);
+            storeBones(bonesFrom);
+        }
+
+        {
+            SPINE_SDL_TRACE_SCOPE("spSkeleton_update");
+            spSkeleton_update(skeleton, pendingDelta);
+        }
+        {
+            SPINE_SDL_TRACE_SCOPE("spAnimationState_update");
+            spAnimationState_update(state, pendingDelta * timeScale);
+        }
+        {
+            SPINE_SDL_TRACE_SCOPE("spAnimationState_apply");
+            spAnimationState_apply(state, skeleton);
+        }
+        // apply() poses a new animation, skin or attachment even while paused, the pose hash skips unchanged poses
+        ++generation;
+        pendingDelta = 0;
+        posed = true;
 
-        if (vertexEffect != 0) vertexEffect->begin(vertexEffect, skeleton);
+        if (blend) {
+            storeBones(bonesTo);
+            if (updateInterval > 1) blendBones(1.0f / updateInterval);
+        } else
+            spFloatArray_clear(bonesTo);
 
-        SDL_Vertex vertex;
-        SDL_Texture *texture = 0;
-        for (int i = 0; i < skeleton->slotsCount; ++i) {
-            spSlot *slot = skeleton->drawOrder[i];
-            spAttachment *attachment = slot->attachment;
-            if (!attachment) continue;
+        // Only the first drawable to reach a pose this frame computes it
+        pose = 0;
+        PoseCache::Key key;
+        bool created = false;
+        if (poseCache && makePoseKey(key)) {
+            pose = poseCache->acquire(key, this, created);
+            poseGeneration = poseCache->generation;
+            worldStale = pose->owner != this;
+            if (worldStale) return;
+        }
+        {
+            SPINE_SDL_TRACE_SCOPE("spSkeleton_updateWorldTransform");
+            spSkeleton_updateWorldTransform(skeleton);
+        }
+        worldStale = false;
+        // An owner updated twice in a frame may reach its own pose again, already built and maybe being read
+        if (created) buildPose();
+    }
 
-            // Early out if slot is invisible
-            if (slot->color.a == 0 || !slot->bone->active) {
-                spSkeletonClipping_clipEnd(clipper, slot);
+    void SkeletonDrawable::setUpdateInterval(int interval) {
+        updateInterval = interval >= 8 ? 8 : interval >= 4 ? 4 : interval >= 2 ? 2 : 1;
+    }
+
+    int SkeletonDrawable::suggestUpdateInterval(float fullRateSize) const {
+        if (culled) return 8;
+        if (!hasBounds) return 1;
+        float size = SDL_max(bounds.w, bounds.h);
+        int interval = 1;
+        for (; interval < 8 && size < fullRateSize; interval <<= 1)
+            size *= 2;
+        return interval;
+    }
+
+    void SkeletonDrawable::storeBones(spFloatArray *pose) {
+        spFloatArray_setSize(pose, skeleton->bonesCount * 7);
+        float *values = pose->items;
+        for (int i = 0; i < skeleton->bonesCount; ++i, values += 7) {
+            spBone *bone = skeleton->bones[i];
+            values[0] = bone->x;
+            values[1] = bone->y;
+            values[2] = bone->rotation;
+            values[3] = bone->scaleX;
+            values[4] = bone->scaleY;
+            values[5] = bone->shearX;
+            values[6] = bone->shearY;
+        }
+    }
+
+    // Angles take the shortest way around
+    static float blendAngle(float from, float to, float alpha) {
+        float delta = to - from;
+        delta -= (16384 - (int) (16384.499999999996 - delta / 360)) * 360;
+        return from + delta * alpha;
+    }
+
+    void SkeletonDrawable::blendBones(float alpha) {
+        const float *from = bonesFrom->items, *to = bonesTo->items;
+        for (int i = 0; i < skeleton->bonesCount; ++i, from += 7, to += 7) {
+            spBone *bone = skeleton->bones[i];
+            if (alpha >= 1) {
+                bone->x = to[0];
+                bone->y = to[1];
+                bone->rotation = to[2];
+                bone->scaleX = to[3];
+                bone->scaleY = to[4];
+                bone->shearX = to[5];
+                bone->shearY = to[6];
                 continue;
             }
+            bone->x = from[0] + (to[0] - from[0]) * alpha;
+            bone->y = from[1] + (to[1] - from[1]) * alpha;
+            bone->rotation = blendAngle(from[2], to[2], alpha);
+            bone->scaleX = from[3] + (to[3] - from[3]) * alpha;
+            bone->scaleY = from[4] + (to[4] - from[4]) * alpha;
+            bone->shearX = blendAngle(from[5], to[5], alpha);
+            bone->shearY = blendAngle(from[6], to[6], alpha);
+        }
+    }
 
-            float *vertices = worldVertices;
-            int verticesCount = 0;
-            float *uvs = 0;
-            unsigned short *indices = 0;
-            int indicesCount = 0;
-            spColor *attachmentColor;
+    void SkeletonDrawable::updateAll(WorkerPool &pool, SkeletonDrawable *const *drawables, int count, float deltaTime) {
+        SPINE_SDL_TRACE_SCOPE("SkeletonDrawable::updateAll");
+        if (pool.getThreadCount() > 0 && !haveDistinctStates(drawables, count)) {
+            SDL_Log("spine-sdl: a skeleton or animation state appears more than once, updating on the calling thread");
+            for (int i = 0; i < count; ++i) drawables[i]->update(deltaTime);
+            return;
+        }
+        UpdateAllContext context;
+        context.drawables = drawables;
+        context.deltaTime = deltaTime;
+        pool.run(updateJob, &context, count);
+    }
 
-            if (attachment->type == SP_ATTACHMENT_REGION) {
-                spRegionAttachment *regionAttachment = (spRegionAttachment *) attachment;
-                attachmentColor = &regionAttachment->color;
+    // Every kernel does the same float operations in the same order as the scalar one and none of them uses fused
+    // multiply-adds, so they give bit-identical results as long as the compiler doesn't contract the scalar ones.
 
-                // Early out if slot is invisible
-                if (attachmentColor->a == 0) {
-                    spSkeletonClipping_clipEnd(clipper, slot);
-                    continue;
-                }
+    // world = (local.x * a + local.y * b + x, local.x * c + local.y * d + y), m is {a, b, c, d, x, y} like a spine bone
+    static void transformScalar(const float *local, float *world, int count, const float *m) {
+        for (int i = 0; i < count; ++i, local += 2, world += 2) {
+            float x = local[0], y = local[1];
+            world[0] = x * m[0] + y * m[1] + m[4];
+            world[1] = x * m[2] + y * m[3] + m[5];
+        }
+    }
 
-                spRegionAttachment_computeWorldVertices(regionAttachment, slot->bone, vertices, 0, 2);
-                verticesCount = 4;
-                uvs = regionAttachment->uvs;
-                indices = quadIndices;
-                indicesCount = 6;
-                texture = (SDL_Texture*) ((spAtlasRegion *) regionAttachment->rendererObject)->page->rendererObject;
+    // Interleaves positions and uvs into SDL_Vertex with a single color
+    static void packScalar(SDL_Vertex *vertices, const float *positions, const float *uvs, int count, SDL_Color color) {
+        for (int i = 0; i < count; ++i, positions += 2, uvs += 2) {
+            vertices[i].position.x = positions[0];
+            vertices[i].position.y = positions[1];
+            vertices[i].color = color;
+            vertices[i].tex_coord.x = uvs[0];
+            vertices[i].tex_coord.y = uvs[1];
+        }
+    }
 
-            } else if (attachment->type == SP_ATTACHMENT_MESH) {
-                spMeshAttachment *mesh = (spMeshAttachment *) attachment;
-                attachmentColor = &mesh->color;
+    // skeleton * slot * attachment color as bytes, each one 4 floats r, g, b, a
+    static SDL_Color modulateScalar(const float *c1, const float *c2, const float *c3) {
+        SDL_Color color;
+        color.r = static_cast<Uint8>(c1[0] * c2[0] * c3[0] * 255);
+        color.g = static_cast<Uint8>(c1[1] * c2[1] * c3[1] * 255);
+        color.b = static_cast<Uint8>(c1[2] * c2[2] * c3[2] * 255);
+        color.a = static_cast<Uint8>(c1[3] * c2[3] * c3[3] * 255);
+        return color;
+    }
 
-                // Early out if slot is invisible
-                if (attachmentColor->a == 0) {
-                    spSkeletonClipping_clipEnd(clipper, slot);
-                    continue;
-                }
+    // Multiplies the color bytes of 32-bit pixels by their alpha byte, which is alphaShift bits up, rounding to nearest
+    static void premultiplyScalar(Uint32 *pixels, int count, int alphaShift) {
+        for (int i = 0; i < count; ++i) {
+            Uint32 pixel = pixels[i];
+            Uint32 alpha = (pixel >> alphaShift) & 0xff;
+            Uint32 result = pixel & (0xffu << alphaShift);
+            for (int shift = 0; shift < 32; shift += 8) {
+                if (shift == alphaShift) continue;
+                Uint32 product = ((pixel >> shift) & 0xff) * alpha + 128;
+                result |= ((product + (product >> 8)) >> 8) << shift;
+            }
+            pixels[i] = result;
+        }
+    }
 
-                if (mesh->super.worldVerticesLength > SPINE_MESH_VERTEX_COUNT_MAX) continue;
-                texture = (SDL_Texture*) ((spAtlasRegion *) mesh->rendererObject)->page->rendererObject;
-                spVertexAttachment_computeWorldVertices(SUPER(mesh), slot, 0, mesh->super.worldVerticesLength, worldVertices, 0, 2);
-                verticesCount = mesh->super.worldVerticesLength >> 1;
-                uvs = mesh->uvs;
-                indices = mesh->triangles;
-                indicesCount = mesh->trianglesCount;
+    // Outcodes of count vertices against edges, each a, b, c with a * x + b * y + c >= 0 on the inner side: bit e if a
+    // vertex is outside one of the first four edges, bit 4 if it's outside any other
+    static void classifyScalar(const float *vertices, int count, const float *edges, int edgeCount, Uint8 *codes) {
+        for (int i = 0; i < count; ++i, vertices += 2) {
+            Uint8 code = 0;
+            for (int e = 0; e < edgeCount; ++e) {
+                const float *edge = edges + e * 3;
+                if (edge[0] * vertices[0] + edge[1] * vertices[1] + edge[2] < 0) code |= e < 4 ? 1 << e : 16;
+            }
+            codes[i] = code;
+        }
+    }
 
-            } else if (attachment->type == SP_ATTACHMENT_CLIPPING) {
-                spClippingAttachment *clip = (spClippingAttachment *) slot->attachment;
-                spSkeletonClipping_clipStart(clipper, slot, clip);
-                continue;
-            } else
-                continue;
+    // A swirl around x, y: vertices within radius turn by angle (radians) times an easing of how close they are to the
+    // center, pow out or pow in and out like spine's PowOut and Pow interpolations
+    struct SwirlParams {
+        float x, y, radius, angle;
+        int power;
+        bool powOut;
+    };
 
-            Uint8 r = static_cast<Uint8>(skeleton->color.r * slot->color.r * attachmentColor->r * 255);
-            Uint8 g = static_cast<Uint8>(skeleton->color.g * slot->color.g * attachmentColor->g * 255);
-            Uint8 b = static_cast<Uint8>(skeleton->color.b * slot->color.b * attachmentColor->b * 255);
-            Uint8 a = static_cast<Uint8>(skeleton->color.a * slot->color.a * attachmentColor->a * 255);
-            vertex.color.r = r;
-            vertex.color.g = g;
-            vertex.color.b = b;
-            vertex.color.a = a;
+    static float powScalar(float x, int power) {
+        float result = x;
+        for (int i = 1; i < power; ++i) result *= x;
+        return result;
+    }
 
-            spColor light;
-            light.r = r / 255.0f;
-            light.g = g / 255.0f;
-            light.b = b / 255.0f;
-            light.a = a / 255.0f;
-
-            SDL_BlendMode blend;
-            switch (slot->data->blendMode) {
-                case SP_BLEND_MODE_NORMAL:
-                    blend = usePremultipliedAlpha ? blend::normalPma : blend::normal;
-                    break;
-                case SP_BLEND_MODE_ADDITIVE:
-                    blend = usePremultipliedAlpha ? blend::additivePma : blend::additive;
-                    break;
-                case SP_BLEND_MODE_MULTIPLY:
-                    blend = usePremultipliedAlpha ? blend::multiplyPma : blend::multiply;
-                    break;
-                case SP_BLEND_MODE_SCREEN:
-                    blend = usePremultipliedAlpha ? blend::screenPma : blend::screen;
-                    break;
-            }
-
-            if (states.texture == 0) states.texture = texture;
-
-            if (states.blendMode != blend || states.texture != texture) {
-                if (vertexArray->size > 0) {
-                    SDL_SetTextureBlendMode(states.texture, states.blendMode);
-                    SDL_RenderGeometry(renderer, states.texture, vertexArray->items, vertexArray->size, 0, 0);
-                    spVertexArray_clear(vertexArray);
-                }
-                states.blendMode = blend;
-                states.texture = texture;
-            }
-
-            if (spSkeletonClipping_isClipping(clipper)) {
-                spSkeletonClipping_clipTriangles(clipper, vertices, verticesCount << 1, indices, indicesCount, uvs, 2);
-                vertices = clipper->clippedVertices->items;
-                verticesCount = clipper->clippedVertices->size >> 1;
-                uvs = clipper->clippedUVs->items;
-                indices = clipper->clippedTriangles->items;
-                indicesCount = clipper->clippedTriangles->size;
-            }
-
-            if (vertexEffect != 0) {
-                spFloatArray_clear(tempUvs);
-                spColorArray_clear(tempColors);
-                for (int j = 0; j < verticesCount; j++) {
-                    spColor vertexColor = light;
-                    spColor dark;
-                    dark.r = dark.g = dark.b = dark.a = 0;
-                    int index = j << 1;
-                    float x = vertices[index];
-                    float y = vertices[index + 1];
-                    float u = uvs[index];
-                    float v = uvs[index + 1];
-                    vertexEffect->transform(vertexEffect, &x, &y, &u, &v, &vertexColor, &dark);
-                    vertices[index] = x;
-                    vertices[index + 1] = y;
-                    spFloatArray_add(tempUvs, u);
-                    spFloatArray_add(tempUvs, v);
-                    spColorArray_add(tempColors, vertexColor);
-                }
+    static float easeScalar(float a, const SwirlParams &p) {
+        if (p.powOut) return powScalar(a - 1, p.power) * (p.power % 2 == 0 ? -1.0f : 1.0f) + 1;
+        if (a <= 0.5f) return powScalar(a * 2, p.power) * 0.5f;
+        return powScalar((a - 1) * 2, p.power) * (p.power % 2 == 0 ? -0.5f : 0.5f) + 1;
+    }
 
-                for (int j = 0; j < indicesCount; ++j) {
-                    int index = indices[j] << 1;
-                    vertex.position.x = vertices[index];
-                    vertex.position.y = vertices[index + 1];
-                    vertex.tex_coord.x = uvs[index];
-                    vertex.tex_coord.y = uvs[index + 1];
-                    spColor vertexColor = tempColors->items[index >> 1];
-                    vertex.color.r = static_cast<Uint8>(vertexColor.r * 255);
-                    vertex.color.g = static_cast<Uint8>(vertexColor.g * 255);
-                    vertex.color.b = static_cast<Uint8>(vertexColor.b * 255);
-                    vertex.color.a = static_cast<Uint8>(vertexColor.a * 255);
-                    spVertexArray_add(vertexArray, vertex);
-                }
-            } else {
-                for (int j = 0; j < indicesCount; ++j)
-                {
-                    int index = indices[j] << 1;
-                    vertex.position.x = vertices[index];
-                    vertex.position.y = vertices[index + 1];
-                    vertex.tex_coord.x = uvs[index];
-                    vertex.tex_coord.y = uvs[index + 1];
-                    spVertexArray_add(vertexArray, vertex);
-                }
+    // sin and cos of x: x minus the nearest multiple of pi / 2, in three parts, then cephes' polynomials on
+    // [-pi / 4, pi / 4], swapped and negated by quadrant
+    static void sinCosScalar(float x, float &s, float &c) {
+        float q = x * 0.636619772f;
+        int k = (int) (q + (q < 0 ? -0.5f : 0.5f));
+        float kf = (float) k;
+        float r = x - kf * 1.5703125f - kf * 4.837512969970703125e-4f - kf * 7.54978995489188216e-8f;
+        float r2 = r * r;
+        float sr = ((-1.9515295891e-4f * r2 + 8.3321608736e-3f) * r2 - 1.6666654611e-1f) * r2 * r + r;
+        float cr = ((2.443315711809948e-5f * r2 - 1.388731625493765e-3f) * r2 + 4.166664568298827e-2f) * r2 * r2 - 0.5f * r2 + 1;
+        s = k & 1 ? cr : sr;
+        c = k & 1 ? sr : cr;
+        if (k & 2) s = -s;
+        if ((k + 1) & 2) c = -c;
+    }
+
+    static void swirlScalar(float *positions, int count, const SwirlParams &p) {
+        for (int i = 0; i < count; ++i, positions += 2) {
+            float x = positions[0] - p.x, y = positions[1] - p.y;
+            float dist = SDL_sqrtf(x * x + y * y);
+            if (!(dist < p.radius)) continue;
+            float s, c;
+            sinCosScalar(p.angle * easeScalar((p.radius - dist) / p.radius, p), s, c);
+            positions[0] = c * x - s * y + p.x;
+            positions[1] = s * x + c * y + p.y;
+        }
+    }
+
+    // Adds amounts[0] to x and amounts[1] to y times (u1 + u2 - 1), a triangular distribution on (-1, 1) from two
+    // uniforms of a xorshift32 generator with 4 lanes, 2 vertices per step
+    static void jitterScalar(float *positions, int count, const float *amounts, Uint32 *state) {
+        for (int i = 0; i < count; i += 2, positions += 4) {
+            float u[8];
+            for (int j = 0; j < 8; ++j) {
+                Uint32 s = state[j & 3];
+                s ^= s << 13;
+                s ^= s >> 17;
+                s ^= s << 5;
+                state[j & 3] = s;
+                u[j] = (float) (s >> 8) * (1.0f / 16777216);
             }
+            for (int j = 0; j < 4 && j < (count - i) * 2; ++j) positions[j] += (u[j] + u[j + 4] - 1) * amounts[j & 1];
+        }
+    }
 
-            spSkeletonClipping_clipEnd(clipper, slot);
+#ifdef SPINE_SDL_SSE2
+    static void transformSse2(const float *local, float *world, int count, const float *m) {
+        __m128 ac = _mm_setr_ps(m[0], m[2], m[0], m[2]);
+        __m128 bd = _mm_setr_ps(m[1], m[3], m[1], m[3]);
+        __m128 xy = _mm_setr_ps(m[4], m[5], m[4], m[5]);
+        int i = 0;
+        for (; i + 2 <= count; i += 2) {
+            __m128 v = _mm_loadu_ps(local + i * 2);
+            __m128 x = _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 2, 0, 0));
+            __m128 y = _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 1, 1));
+            _mm_storeu_ps(world + i * 2, _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, ac), _mm_mul_ps(y, bd)), xy));
         }
+        transformScalar(local + i * 2, world + i * 2, count - i, m);
+    }
 
-        if (vertexArray->size > 0)
-        {
-            SDL_SetTextureBlendMode(states.texture, states.blendMode);
-            SDL_RenderGeometry(renderer, states.texture, vertexArray->items, vertexArray->size, 0, 0);
-            spVertexArray_clear(vertexArray);
+    // Four vertices are 20 floats, written as five unaligned stores
+    static void packSse2(SDL_Vertex *vertices, const float *positions, const float *uvs, int count, SDL_Color color) {
+        int i = 0;
+        if (sizeof(SDL_Vertex) == 5 * sizeof(float)) {
+            Uint32 bits;
+            SDL_memcpy(&bits, &color, sizeof(bits));
+            __m128 c = _mm_castsi128_ps(_mm_set1_epi32((int) bits));
+            for (; i + 4 <= count; i += 4) {
+                __m128 p01 = _mm_loadu_ps(positions + i * 2), p23 = _mm_loadu_ps(positions + i * 2 + 4);
+                __m128 t01 = _mm_loadu_ps(uvs + i * 2), t23 = _mm_loadu_ps(uvs + i * 2 + 4);
+                float *out = (float *) (vertices + i);
+                __m128 v0x1x1 = _mm_shuffle_ps(t01, p01, _MM_SHUFFLE(3, 2, 1, 1));
+                __m128 y1y1cc = _mm_shuffle_ps(p01, c, _MM_SHUFFLE(0, 0, 3, 3));
+                __m128 ccu2v2 = _mm_shuffle_ps(c, t23, _MM_SHUFFLE(1, 0, 0, 0));
+                __m128 v2v2x3x3 = _mm_shuffle_ps(t23, p23, _MM_SHUFFLE(2, 2, 1, 1));
+                __m128 y3y3cc = _mm_shuffle_ps(p23, c, _MM_SHUFFLE(0, 0, 3, 3));
+                _mm_storeu_ps(out, _mm_movelh_ps(p01, _mm_unpacklo_ps(c, t01)));
+                _mm_storeu_ps(out + 4, _mm_shuffle_ps(v0x1x1, y1y1cc, _MM_SHUFFLE(2, 1, 2, 0)));
+                _mm_storeu_ps(out + 8, _mm_shuffle_ps(t01, p23, _MM_SHUFFLE(1, 0, 3, 2)));
+                _mm_storeu_ps(out + 12, _mm_shuffle_ps(ccu2v2, v2v2x3x3, _MM_SHUFFLE(2, 0, 2, 0)));
+                _mm_storeu_ps(out + 16, _mm_shuffle_ps(y3y3cc, t23, _MM_SHUFFLE(3, 2, 2, 0)));
+            }
+        }
+        packScalar(vertices + i, positions + i * 2, uvs + i * 2, count - i, color);
+    }
+
+    static SDL_Color modulateSse2(const float *c1, const float *c2, const float *c3) {
+        __m128 c = _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(_mm_loadu_ps(c1), _mm_loadu_ps(c2)), _mm_loadu_ps(c3)), _mm_set1_ps(255));
+        __m128i bytes = _mm_cvttps_epi32(c);
+        bytes = _mm_packs_epi32(bytes, bytes);
+        bytes = _mm_packus_epi16(bytes, bytes);
+        Uint32 bits = (Uint32) _mm_cvtsi128_si32(bytes);
+        SDL_Color color;
+        SDL_memcpy(&color, &bits, sizeof(color));
+        return color;
+    }
+
+    static void premultiplySse2(Uint32 *pixels, int count, int alphaShift) {
+        const __m128i shift = _mm_cvtsi32_si128(alphaShift);
+        const __m128i alphaMask = _mm_set1_epi32((int) (0xffu << alphaShift));
+        const __m128i byteMask = _mm_set1_epi32(0xff);
+        const __m128i half = _mm_set1_epi16(128);
+        const __m128i zero = _mm_setzero_si128();
+        int i = 0;
+        for (; i + 4 <= count; i += 4) {
+            __m128i p = _mm_loadu_si128((const __m128i *) (pixels + i));
+            // Alpha copied to every byte of its pixel
+            __m128i a = _mm_and_si128(_mm_srl_epi32(p, shift), byteMask);
+            a = _mm_or_si128(_mm_or_si128(a, _mm_slli_epi32(a, 8)), _mm_or_si128(_mm_slli_epi32(a, 16), _mm_slli_epi32(a, 24)));
+            // (c * a + 128 + ((c * a + 128) >> 8)) >> 8 in 16-bit lanes, exactly like premultiplyScalar()
+            __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(p, zero), _mm_unpacklo_epi8(a, zero)), half);
+            __m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(p, zero), _mm_unpackhi_epi8(a, zero)), half);
+            lo = _mm_srli_epi16(_mm_add_epi16(lo, _mm_srli_epi16(lo, 8)), 8);
+            hi = _mm_srli_epi16(_mm_add_epi16(hi, _mm_srli_epi16(hi, 8)), 8);
+            __m128i result = _mm_packus_epi16(lo, hi);
+            result = _mm_or_si128(_mm_andnot_si128(alphaMask, result), _mm_and_si128(alphaMask, p));
+            _mm_storeu_si128((__m128i *) (pixels + i), result);
+        }
+        premultiplyScalar(pixels + i, count - i, alphaShift);
+    }
+
+    // Four vertices at a time, one edge after the other
+    static void classifySse2(const float *vertices, int count, const float *edges, int edgeCount, Uint8 *codes) {
+        const __m128 zero = _mm_setzero_ps();
+        int i = 0;
+        for (; i + 4 <= count; i += 4) {
+            __m128 v01 = _mm_loadu_ps(vertices + i * 2), v23 = _mm_loadu_ps(vertices + i * 2 + 4);
+            __m128 x = _mm_shuffle_ps(v01, v23, _MM_SHUFFLE(2, 0, 2, 0));
+            __m128 y = _mm_shuffle_ps(v01, v23, _MM_SHUFFLE(3, 1, 3, 1));
+            __m128i code = _mm_setzero_si128();
+            for (int e = 0; e < edgeCount; ++e) {
+                const float *edge = edges + e * 3;
+                __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(edge[0]), x), _mm_mul_ps(_mm_set1_ps(edge[1]), y)), _mm_set1_ps(edge[2]));
+                __m128i outside = _mm_castps_si128(_mm_cmplt_ps(d, zero));
+                code = _mm_or_si128(code, _mm_and_si128(outside, _mm_set1_epi32(e < 4 ? 1 << e : 16)));
+            }
+            code = _mm_packs_epi32(code, code);
+            code = _mm_packus_epi16(code, code);
+            Uint32 bytes = (Uint32) _mm_cvtsi128_si32(code);
+            SDL_memcpy(codes + i, &bytes, sizeof(bytes));
+        }
+        classifyScalar(vertices + i * 2, count - i, edges, edgeCount, codes + i);
+    }
+
+    static __m128 powSse2(__m128 x, int power) {
+        __m128 result = x;
+        for (int i = 1; i < power; ++i) result = _mm_mul_ps(result, x);
+        return result;
+    }
+
+    static __m128 easeSse2(__m128 a, const SwirlParams &p) {
+        const __m128 one = _mm_set1_ps(1), two = _mm_set1_ps(2), half = _mm_set1_ps(0.5f);
+        const __m128 sign = _mm_set1_ps(p.power % 2 == 0 ? -1.0f : 1.0f);
+        if (p.powOut) return _mm_add_ps(_mm_mul_ps(powSse2(_mm_sub_ps(a, one), p.power), sign), one);
+        __m128 in = _mm_mul_ps(powSse2(_mm_mul_ps(a, two), p.power), half);
+        __m128 out = _mm_add_ps(_mm_mul_ps(powSse2(_mm_mul_ps(_mm_sub_ps(a, one), two), p.power), _mm_mul_ps(sign, half)), one);
+        __m128 low = _mm_cmple_ps(a, half);
+        return _mm_or_ps(_mm_and_ps(low, in), _mm_andnot_ps(low, out));
+    }
+
+    static void sinCosSse2(__m128 x, __m128 &s, __m128 &c) {
+        const __m128 sign = _mm_set1_ps(-0.0f);
+        const __m128i one = _mm_set1_epi32(1), two = _mm_set1_epi32(2);
+        __m128 q = _mm_mul_ps(x, _mm_set1_ps(0.636619772f));
+        __m128 half = _mm_or_ps(_mm_and_ps(_mm_cmplt_ps(q, _mm_setzero_ps()), sign), _mm_set1_ps(0.5f));
+        __m128i k = _mm_cvttps_epi32(_mm_add_ps(q, half));
+        __m128 kf = _mm_cvtepi32_ps(k);
+        __m128 r = _mm_sub_ps(x, _mm_mul_ps(kf, _mm_set1_ps(1.5703125f)));
+        r = _mm_sub_ps(r, _mm_mul_ps(kf, _mm_set1_ps(4.837512969970703125e-4f)));
+        r = _mm_sub_ps(r, _mm_mul_ps(kf, _mm_set1_ps(7.54978995489188216e-8f)));
+        __m128 r2 = _mm_mul_ps(r, r);
+        __m128 sp = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(-1.9515295891e-4f), r2), _mm_set1_ps(8.3321608736e-3f));
+        sp = _mm_sub_ps(_mm_mul_ps(sp, r2), _mm_set1_ps(1.6666654611e-1f));
+        __m128 sr = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(sp, r2), r), r);
+        __m128 cp = _mm_sub_ps(_mm_mul_ps(_mm_set1_ps(2.443315711809948e-5f), r2), _mm_set1_ps(1.388731625493765e-3f));
+        cp = _mm_add_ps(_mm_mul_ps(cp, r2), _mm_set1_ps(4.166664568298827e-2f));
+        __m128 cr = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(_mm_mul_ps(cp, r2), r2), _mm_mul_ps(_mm_set1_ps(0.5f), r2)), _mm_set1_ps(1));
+        __m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(k, one), one));
+        __m128 negateS = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(k, two), two));
+        __m128 negateC = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(_mm_add_epi32(k, one), two), two));
+        s = _mm_xor_ps(_mm_or_ps(_mm_and_ps(swap, cr), _mm_andnot_ps(swap, sr)), _mm_and_ps(negateS, sign));
+        c = _mm_xor_ps(_mm_or_ps(_mm_and_ps(swap, sr), _mm_andnot_ps(swap, cr)), _mm_and_ps(negateC, sign));
+    }
+
+    // Four vertices at a time, skipped when all of them are outside the radius
+    static void swirlSse2(float *positions, int count, const SwirlParams &p) {
+        const __m128 cx = _mm_set1_ps(p.x), cy = _mm_set1_ps(p.y), radius = _mm_set1_ps(p.radius), angle = _mm_set1_ps(p.angle);
+        int i = 0;
+        for (; i + 4 <= count; i += 4) {
+            float *v = positions + i * 2;
+            __m128 v01 = _mm_loadu_ps(v), v23 = _mm_loadu_ps(v + 4);
+            __m128 vx = _mm_shuffle_ps(v01, v23, _MM_SHUFFLE(2, 0, 2, 0));
+            __m128 vy = _mm_shuffle_ps(v01, v23, _MM_SHUFFLE(3, 1, 3, 1));
+            __m128 x = _mm_sub_ps(vx, cx), y = _mm_sub_ps(vy, cy);
+            __m128 dist = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)));
+            __m128 inside = _mm_cmplt_ps(dist, radius);
+            if (_mm_movemask_ps(inside) == 0) continue;
+            __m128 s, c;
+            sinCosSse2(_mm_mul_ps(angle, easeSse2(_mm_div_ps(_mm_sub_ps(radius, dist), radius), p)), s, c);
+            __m128 nx = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(c, x), _mm_mul_ps(s, y)), cx);
+            __m128 ny = _mm_add_ps(_mm_add_ps(_mm_mul_ps(s, x), _mm_mul_ps(c, y)), cy);
+            nx = _mm_or_ps(_mm_and_ps(inside, nx), _mm_andnot_ps(inside, vx));
+            ny = _mm_or_ps(_mm_and_ps(inside, ny), _mm_andnot_ps(inside, vy));
+            _mm_storeu_ps(v, _mm_unpacklo_ps(nx, ny));
+            _mm_storeu_ps(v + 4, _mm_unpackhi_ps(nx, ny));
         }
+        swirlScalar(positions + i * 2, count - i, p);
+    }
 
-        spSkeletonClipping_clipEnd2(clipper);
+    static __m128i xorshiftSse2(__m128i s) {
+        s = _mm_xor_si128(s, _mm_slli_epi32(s, 13));
+        s = _mm_xor_si128(s, _mm_srli_epi32(s, 17));
+        return _mm_xor_si128(s, _mm_slli_epi32(s, 5));
+    }
+
+    static void jitterSse2(float *positions, int count, const float *amounts, Uint32 *state) {
+        const __m128 amount = _mm_setr_ps(amounts[0], amounts[1], amounts[0], amounts[1]);
+        const __m128 scale = _mm_set1_ps(1.0f / 16777216), one = _mm_set1_ps(1);
+        __m128i s = _mm_loadu_si128((const __m128i *) state);
+        int i = 0;
+        for (; i + 2 <= count; i += 2) {
+            s = xorshiftSse2(s);
+            __m128 u1 = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(s, 8)), scale);
+            s = xorshiftSse2(s);
+            __m128 u2 = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(s, 8)), scale);
+            __m128 v = _mm_loadu_ps(positions + i * 2);
+            _mm_storeu_ps(positions + i * 2, _mm_add_ps(v, _mm_mul_ps(_mm_sub_ps(_mm_add_ps(u1, u2), one), amount)));
+        }
+        _mm_storeu_si128((__m128i *) state, s);
+        jitterScalar(positions + i * 2, count - i, amounts, state);
+    }
+#endif
+
+#ifdef SPINE_SDL_AVX2
+    SPINE_SDL_TARGET_AVX2 static void transformAvx2(const float *local, float *world, int count, const float *m) {
+        __m256 ac = _mm256_setr_ps(m[0], m[2], m[0], m[2], m[0], m[2], m[0], m[2]);
+        __m256 bd = _mm256_setr_ps(m[1], m[3], m[1], m[3], m[1], m[3], m[1], m[3]);
+        __m256 xy = _mm256_setr_ps(m[4], m[5], m[4], m[5], m[4], m[5], m[4], m[5]);
+        int i = 0;
+        for (; i + 4 <= count; i += 4) {
+            __m256 v = _mm256_loadu_ps(local + i * 2);
+            __m256 x = _mm256_shuffle_ps(v, v, _MM_SHUFFLE(2, 2, 0, 0));
+            __m256 y = _mm256_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 1, 1));
+            _mm256_storeu_ps(world + i * 2, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, ac), _mm256_mul_ps(y, bd)), xy));
+        }
+        _mm256_zeroupper();
+        transformSse2(local + i * 2, world + i * 2, count - i, m);
+    }
+#endif
+
+#ifdef SPINE_SDL_NEON
+    static void transformNeon(const float *local, float *world, int count, const float *m) {
+        float32x4_t ac = {m[0], m[2], m[0], m[2]};
+        float32x4_t bd = {m[1], m[3], m[1], m[3]};
+        float32x4_t xy = {m[4], m[5], m[4], m[5]};
+        int i = 0;
+        for (; i + 4 <= count; i += 4) {
+            // vld2q splits x and y, zipping them back doubles each lane the way the matrix columns need
+            float32x4x2_t v = vld2q_f32(local + i * 2);
+            float32x4x2_t x = vzipq_f32(v.val[0], v.val[0]);
+            float32x4x2_t y = vzipq_f32(v.val[1], v.val[1]);
+            vst1q_f32(world + i * 2, vaddq_f32(vaddq_f32(vmulq_f32(x.val[0], ac), vmulq_f32(y.val[0], bd)), xy));
+            vst1q_f32(world + i * 2 + 4, vaddq_f32(vaddq_f32(vmulq_f32(x.val[1], ac), vmulq_f32(y.val[1], bd)), xy));
+        }
+        transformScalar(local + i * 2, world + i * 2, count - i, m);
+    }
+
+    static SDL_Color modulateNeon(const float *c1, const float *c2, const float *c3) {
+        float32x4_t c = vmulq_n_f32(vmulq_f32(vmulq_f32(vld1q_f32(c1), vld1q_f32(c2)), vld1q_f32(c3)), 255);
+        uint16x4_t shorts = vmovn_u32(vcvtq_u32_f32(c));
+        uint8x8_t bytes = vmovn_u16(vcombine_u16(shorts, shorts));
+        SDL_Color color;
+        SDL_memcpy(&color, &bytes, sizeof(color));
+        return color;
+    }
+
+    static void premultiplyNeon(Uint32 *pixels, int count, int alphaShift) {
+        const int32x4_t shift = vdupq_n_s32(-alphaShift);
+        const uint32x4_t alphaMask = vdupq_n_u32(0xffu << alphaShift);
+        int i = 0;
+        for (; i + 4 <= count; i += 4) {
+            uint32x4_t p = vld1q_u32(pixels + i);
+            uint8x16_t a = vreinterpretq_u8_u32(vmulq_n_u32(vandq_u32(vshlq_u32(p, shift), vdupq_n_u32(0xff)), 0x01010101));
+            uint8x16_t c = vreinterpretq_u8_u32(p);
+            // vraddhn(x, (x + 128) >> 8) is the same rounding as premultiplyScalar()
+            uint16x8_t lo = vmull_u8(vget_low_u8(c), vget_low_u8(a));
+            uint16x8_t hi = vmull_u8(vget_high_u8(c), vget_high_u8(a));
+            uint8x16_t result = vcombine_u8(vraddhn_u16(lo, vrshrq_n_u16(lo, 8)), vraddhn_u16(hi, vrshrq_n_u16(hi, 8)));
+            vst1q_u32(pixels + i, vbslq_u32(alphaMask, p, vreinterpretq_u32_u8(result)));
+        }
+        premultiplyScalar(pixels + i, count - i, alphaShift);
+    }
+
+    static void classifyNeon(const float *vertices, int count, const float *edges, int edgeCount, Uint8 *codes) {
+        const float32x4_t zero = vdupq_n_f32(0);
+        int i = 0;
+        for (; i + 4 <= count; i += 4) {
+            float32x4x2_t v = vld2q_f32(vertices + i * 2);
+            uint32x4_t code = vdupq_n_u32(0);
+            for (int e = 0; e < edgeCount; ++e) {
+                const float *edge = edges + e * 3;
+                float32x4_t d = vaddq_f32(vaddq_f32(vmulq_n_f32(v.val[0], edge[0]), vmulq_n_f32(v.val[1], edge[1])), vdupq_n_f32(edge[2]));
+                code = vorrq_u32(code, vandq_u32(vcltq_f32(d, zero), vdupq_n_u32(e < 4 ? 1u << e : 16u)));
+            }
+            uint16x4_t shorts = vmovn_u32(code);
+            uint8x8_t bytes = vmovn_u16(vcombine_u16(shorts, shorts));
+            SDL_memcpy(codes + i, &bytes, 4);
+        }
+        classifyScalar(vertices + i * 2, count - i, edges, edgeCount, codes + i);
+    }
+
+    static uint32x4_t xorshiftNeon(uint32x4_t s) {
+        s = veorq_u32(s, vshlq_n_u32(s, 13));
+        s = veorq_u32(s, vshrq_n_u32(s, 17));
+        return veorq_u32(s, vshlq_n_u32(s, 5));
+    }
+
+    static void jitterNeon(float *positions, int count, const float *amounts, Uint32 *state) {
+        const float32x4_t amount = {amounts[0], amounts[1], amounts[0], amounts[1]};
+        const float32x4_t one = vdupq_n_f32(1);
+        uint32x4_t s = vld1q_u32(state);
+        int i = 0;
+        for (; i + 2 <= count; i += 2) {
+            s = xorshiftNeon(s);
+            float32x4_t u1 = vmulq_n_f32(vcvtq_f32_u32(vshrq_n_u32(s, 8)), 1.0f / 16777216);
+            s = xorshiftNeon(s);
+            float32x4_t u2 = vmulq_n_f32(vcvtq_f32_u32(vshrq_n_u32(s, 8)), 1.0f / 16777216);
+            float32x4_t v = vld1q_f32(positions + i * 2);
+            vst1q_f32(positions + i * 2, vaddq_f32(v, vmulq_f32(vsubq_f32(vaddq_f32(u1, u2), one), amount)));
+        }
+        vst1q_u32(state, s);
+        jitterScalar(positions + i * 2, count - i, amounts, state);
+    }
+#endif
+
+    struct VertexKernels {
+        const char *name;
+        void (*transform)(const float *local, float *world, int count, const float *m);
+        void (*pack)(SDL_Vertex *vertices, const float *positions, const float *uvs, int count, SDL_Color color);
+        SDL_Color (*modulate)(const float *c1, const float *c2, const float *c3);
+        void (*premultiply)(Uint32 *pixels, int count, int alphaShift);
+        void (*classify)(const float *vertices, int count, const float *edges, int edgeCount, Uint8 *codes);
+        void (*swirl)(float *positions, int count, const SwirlParams &params);
+        void (*jitter)(float *positions, int count, const float *amounts, Uint32 *state);
+    };
+
+    static const VertexKernels scalarKernels = {"scalar", transformScalar, packScalar, modulateScalar, premultiplyScalar, classifyScalar,
+                                                swirlScalar, jitterScalar};
+
+    static VertexKernels detectKernels() {
+        VertexKernels kernels = scalarKernels;
+#ifdef SPINE_SDL_SSE2
+        if (SDL_HasSSE2()) {
+            kernels.name = "sse2";
+            kernels.transform = transformSse2;
+            kernels.pack = packSse2;
+            kernels.modulate = modulateSse2;
+            kernels.premultiply = premultiplySse2;
+            kernels.classify = classifySse2;
+            kernels.swirl = swirlSse2;
+            kernels.jitter = jitterSse2;
+        }
+#endif
+#ifdef SPINE_SDL_AVX2
+        if (SDL_HasSSE2() && SDL_HasAVX2()) {
+            kernels.name = "avx2";
+            kernels.transform = transformAvx2;
+        }
+#endif
+#ifdef SPINE_SDL_NEON
+        if (SDL_HasNEON()) {
+            kernels.name = "neon";
+            kernels.transform = transformNeon;
+            kernels.modulate = modulateNeon;
+            kernels.premultiply = premultiplyNeon;
+            kernels.classify = classifyNeon;
+            kernels.jitter = jitterNeon;
+        }
+#endif
+        return kernels;
+    }
+
+    static const VertexKernels detectedKernels = detectKernels();
+    static const VertexKernels *kernels = &detectedKernels;
+
+    const char *getSimdName() {
+        return kernels->name;
+    }
+
+    void setSimdEnabled(bool enabled) {
+        kernels = enabled ? &detectedKernels : &scalarKernels;
+    }
+
+    // Deterministic inputs for verifySimdKernels(), between -range and range
+    static float kernelInput(Uint32 &seed, float range) {
+        seed = seed * 1664525u + 1013904223u;
+        return ((float) (seed >> 8) * (1.0f / 8388608) - 1) * range;
+    }
+
+    static bool kernelMatches(const char *kernel, int count, const void *scalar, const void *simd, size_t size) {
+        if (SDL_memcmp(scalar, simd, size) == 0) return true;
+        SDL_Log("spine-sdl: the %s %s kernel differs from the scalar one with a count of %d", detectedKernels.name, kernel, count);
+        return false;
+    }
+
+    int verifySimdKernels() {
+        // Up to 19 leaves every tail of the 2, 4 and 8 wide kernels; a margin past count catches stray stores
+        const int maxCount = 19, margin = 5;
+        float local[(maxCount + margin) * 2], world[2][(maxCount + margin) * 2], uvs[(maxCount + margin) * 2];
+        SDL_Vertex vertices[2][maxCount + margin];
+        Uint32 pixels[2][maxCount + margin];
+        Uint8 codes[2][maxCount + margin];
+        Uint32 seed = 1;
+        for (int i = 0; i < (maxCount + margin) * 2; ++i) {
+            local[i] = kernelInput(seed, 200);
+            uvs[i] = kernelInput(seed, 1);
+        }
+        // Exactly on the edges and at the center of the swirl
+        local[0] = local[1] = 0;
+        local[2] = 100;
+        local[3] = 0;
+        const Uint8 bytes[] = {0, 1, 127, 128, 254, 255};
+        const float m[6] = {0.8f, -0.6f, 0.6f, 0.8f, 12.5f, -3.25f};
+        const float edges[] = {1, 0, 100, -1, 0, 100, 0, 1, 100, 0, -1, 100, 1, 1, 120, 1, -1, 120};
+        const float amounts[2] = {3, 1.5f};
+        bool transformOk = true, packOk = true, premultiplyOk = true, classifyOk = true, swirlOk = true, jitterOk = true;
+
+        for (int count = 0; count <= maxCount; ++count) {
+            SDL_memset(world, 0xcd, sizeof(world));
+            scalarKernels.transform(local, world[0], count, m);
+            detectedKernels.transform(local, world[1], count, m);
+            if (transformOk) transformOk = kernelMatches("transform", count, world[0], world[1], sizeof(world[0]));
+
+            SDL_Color color = {bytes[count % 6], bytes[(count + 1) % 6], bytes[(count + 3) % 6], bytes[(count + 5) % 6]};
+            SDL_memset(vertices, 0xcd, sizeof(vertices));
+            scalarKernels.pack(vertices[0], local, uvs, count, color);
+            detectedKernels.pack(vertices[1], local, uvs, count, color);
+            if (packOk) packOk = kernelMatches("pack", count, vertices[0], vertices[1], sizeof(vertices[0]));
+
+            // Channel and alpha bytes at 0, 1, 127, 128, 254 and 255, every pairing across the counts, with the alpha at
+            // both ends of the pixel
+            for (int alphaShift = 0; alphaShift <= 24 && premultiplyOk; alphaShift += 24) {
+                for (int i = 0; i < maxCount + margin; ++i) {
+                    Uint32 pixel = 0;
+                    for (int shift = 0; shift < 32; shift += 8) pixel |= (Uint32) bytes[(i + count * (shift / 8 + 1)) % 6] << shift;
+                    pixels[0][i] = pixels[1][i] = pixel;
+                }
+                scalarKernels.premultiply(pixels[0], count, alphaShift);
+                detectedKernels.premultiply(pixels[1], count, alphaShift);
+                premultiplyOk = kernelMatches("premultiply", count, pixels[0], pixels[1], sizeof(pixels[0]));
+            }
+
+            for (int edgeCount = 0; edgeCount <= 6 && classifyOk; edgeCount += 3) {
+                SDL_memset(codes, 0xcd, sizeof(codes));
+                scalarKernels.classify(local, count, edges, edgeCount, codes[0]);
+                detectedKernels.classify(local, count, edges, edgeCount, codes[1]);
+                classifyOk = kernelMatches("classify", count, codes[0], codes[1], sizeof(codes[0]));
+            }
+
+            for (int power = 2; power <= 3 && swirlOk; ++power) {
+                for (int powOut = 0; powOut < 2 && swirlOk; ++powOut) {
+                    SwirlParams params = {0, 0, 100, 1.25f, power, powOut == 1};
+                    SDL_memcpy(world[0], local, sizeof(local));
+                    SDL_memcpy(world[1], local, sizeof(local));
+                    scalarKernels.swirl(world[0], count, params);
+                    detectedKernels.swirl(world[1], count, params);
+                    swirlOk = kernelMatches("swirl", count, world[0], world[1], sizeof(world[0]));
+                }
+            }
+
+            Uint32 state[2][4] = {{1, 2, 3, 4}, {1, 2, 3, 4}};
+            SDL_memcpy(world[0], local, sizeof(local));
+            SDL_memcpy(world[1], local, sizeof(local));
+            scalarKernels.jitter(world[0], count, amounts, state[0]);
+            detectedKernels.jitter(world[1], count, amounts, state[1]);
+            if (jitterOk) jitterOk = kernelMatches("jitter", count, world[0], world[1], sizeof(world[0])) &&
+                                     kernelMatches("jitter", count, state[0], state[1], sizeof(state[0]));
+        }
+
+        // Every product of 0, 1 / 255, 0.5, 254 / 255 and 1, where the truncation to a byte is closest to flipping
+        const float levels[] = {0, 1 / 255.0f, 0.5f, 254 / 255.0f, 1};
+        bool modulateOk = true;
+        for (int i = 0; i < 125 && modulateOk; ++i) {
+            float c1[4], c2[4], c3[4];
+            for (int j = 0; j < 4; ++j) {
+                c1[j] = levels[(i + j) % 5];
+                c2[j] = levels[(i / 5 + j) % 5];
+                c3[j] = levels[(i / 25 + j) % 5];
+            }
+            SDL_Color scalar = scalarKernels.modulate(c1, c2, c3), simd = detectedKernels.modulate(c1, c2, c3);
+            modulateOk = kernelMatches("modulate", 1, &scalar, &simd, sizeof(SDL_Color));
+        }
+
+        bool results[] = {transformOk, packOk, modulateOk, premultiplyOk, classifyOk, swirlOk, jitterOk};
+        int failures = 0;
+        for (int i = 0; i < 7; ++i) failures += results[i] ? 0 : 1;
+        return failures;
+    }
+
+    // Bumped every time AsyncTextureLoader uploads a page, so cached geometry that skipped its slots gets rebuilt
+    static SDL_atomic_t pagesUploaded;
+
+    static SDL_BlendMode getBlendMode(spBlendMode mode, bool premultipliedAlpha) {
+        switch (mode) {
+            case SP_BLEND_MODE_ADDITIVE:
+                return premultipliedAlpha ? blend::additivePma : blend::additive;
+            case SP_BLEND_MODE_MULTIPLY:
+                return premultipliedAlpha ? blend::multiplyPma : blend::multiply;
+            case SP_BLEND_MODE_SCREEN:
+                return premultipliedAlpha ? blend::screenPma : blend::screen;
+            default:
+                return premultipliedAlpha ? blend::normalPma : blend::normal;
+        }
+    }
+
+    // Appends the geometry of source to list, moved by x, y
+    static void appendTranslated(RenderCommandList &list, const RenderCommandList &source, float x, float y) {
+        for (int i = 0; i < source.commands->size; ++i) {
+            const RenderCommand &command = source.commands->items[i];
+            int firstVertex = list.vertexArray->size;
+            int firstIndex = list.indexArray->size;
+            SDL_FRect clipRect;
+            int indexOffset = list.add(command.texture, command.blendMode, command.vertexCount, command.indexCount,
+                                       translateClipRect(command, x, y, clipRect));
+
+            const SDL_Vertex *sourceVertex = source.vertexArray->items + command.firstVertex;
+            SDL_Vertex *vertex = list.vertexArray->items + firstVertex;
+            for (int ii = 0; ii < command.vertexCount; ++ii, ++vertex, ++sourceVertex) {
+                *vertex = *sourceVertex;
+                vertex->position.x += x;
+                vertex->position.y += y;
+            }
+            const int *sourceIndices = source.indexArray->items + command.firstIndex;
+            int *index = list.indexArray->items + firstIndex;
+            for (int ii = 0; ii < command.indexCount; ++ii)
+                index[ii] = indexOffset + sourceIndices[ii];
+        }
+    }
+
+    // Grows bounds (min x, min y, max x, max y) to contain count x,y pairs
+    static void growBounds(float *bounds, const float *vertices, int count) {
+        for (int i = 0; i < count; ++i) {
+            float x = vertices[i << 1], y = vertices[(i << 1) + 1];
+            if (x < bounds[0]) bounds[0] = x;
+            if (y < bounds[1]) bounds[1] = y;
+            if (x > bounds[2]) bounds[2] = x;
+            if (y > bounds[3]) bounds[3] = y;
+        }
+    }
+
+    static bool missesViewport(const float *bounds, const SDL_FRect &viewport) {
+        return bounds[2] < viewport.x || bounds[0] > viewport.x + viewport.w || bounds[3] < viewport.y || bounds[1] > viewport.y + viewport.h;
+    }
+
+    // Smallest rectangle containing the origin of every active bone
+    static bool getBoneBounds(spSkeleton *skeleton, float *bounds) {
+        bounds[0] = bounds[1] = FLT_MAX;
+        bounds[2] = bounds[3] = -FLT_MAX;
+        for (int i = 0; i < skeleton->bonesCount; ++i) {
+            spBone *bone = skeleton->bones[i];
+            if (!bone->active) continue;
+            float origin[2] = {bone->worldX, bone->worldY};
+            growBounds(bounds, origin, 1);
+        }
+        return bounds[0] <= bounds[2];
+    }
+
+    // A clipping polygon that is still an axis-aligned rectangle after the world transform (the usual UI mask) can be
+    // left to the renderer's clip rect, which costs nothing, instead of clipping every triangle it covers
+    static bool getClipRectangle(spSlot *slot, spClippingAttachment *clip, float *vertices, SDL_FRect &rect) {
+        if (clip->super.worldVerticesLength != 8) return false;
+        spVertexAttachment_computeWorldVertices(SUPER(clip), slot, 0, 8, vertices, 0, 2);
+        // The edges alternate between vertical and horizontal, starting with either
+        const float epsilon = 0.001f;
+        bool verticalFirst = SDL_fabsf(vertices[0] - vertices[2]) < epsilon;
+        for (int i = 0; i < 4; ++i) {
+            const float *a = vertices + i * 2, *b = vertices + ((i + 1) & 3) * 2;
+            bool vertical = (i & 1) == 0 ? verticalFirst : !verticalFirst;
+            if (SDL_fabsf(vertical ? a[0] - b[0] : a[1] - b[1]) >= epsilon) return false;
+        }
+        float bounds[4] = {FLT_MAX, FLT_MAX, -FLT_MAX, -FLT_MAX};
+        growBounds(bounds, vertices, 4);
+        rect.x = bounds[0];
+        rect.y = bounds[1];
+        rect.w = bounds[2] - bounds[0];
+        rect.h = bounds[3] - bounds[1];
+        return rect.w > 0 && rect.h > 0;
+    }
+
+    // FNV-1a over the bits of count floats
+    static Uint64 hashFloats(Uint64 hash, const float *values, int count) {
+        for (int i = 0; i < count; ++i) {
+            Uint32 bits;
+            SDL_memcpy(&bits, values + i, sizeof(bits));
+            hash = (hash ^ bits) * 1099511628211ull;
+        }
+        return hash;
+    }
+
+    // Twice the signed area of a polygon of count x, y pairs
+    static float getPolygonArea(const float *polygon, int count) {
+        float area = 0;
+        for (int i = 0, j = count - 1; i < count; j = i++)
+            area += polygon[j * 2] * polygon[i * 2 + 1] - polygon[i * 2] * polygon[j * 2 + 1];
+        return area;
+    }
+
+    SlotClipper::Output::Output() : key(0), valid(false) {
+        vertices = spFloatArray_create(64);
+        uvs = spFloatArray_create(64);
+        triangles = spUnsignedShortArray_create(96);
+    }
+
+    SlotClipper::Output::~Output() {
+        spFloatArray_dispose(vertices);
+        spFloatArray_dispose(uvs);
+        spUnsignedShortArray_dispose(triangles);
+    }
+
+    SlotClipper::SlotClipper()
+        : clip(0), scissor(0), polygonHash(0), scratchSize(0), codes(0), remap(0), codesCapacity(0), outputs(0), outputsCapacity(0),
+          output(&uncached) {
+        polygon = spFloatArray_create(16);
+        triangulator = spTriangulator_create();
+        parts = spIntArray_create(8);
+        edges = spFloatArray_create(64);
+        scratch = spFloatArray_create(64);
+    }
+
+    SlotClipper::~SlotClipper() {
+        for (int i = 0; i < outputsCapacity; ++i) delete outputs[i];
+        FREE(outputs);
+        FREE(codes);
+        FREE(remap);
+        spFloatArray_dispose(polygon);
+        spTriangulator_dispose(triangulator);
+        spIntArray_dispose(parts);
+        spFloatArray_dispose(edges);
+        spFloatArray_dispose(scratch);
+    }
+
+    void SlotClipper::clipStart(spSlot *slot, spClippingAttachment *clipAttachment) {
+        int length = clipAttachment->super.worldVerticesLength;
+        if (clip != 0 || length < 6) return;
+        clip = clipAttachment;
+        spFloatArray_setSize(polygon, length);
+        spVertexAttachment_computeWorldVertices(SUPER(clipAttachment), slot, 0, length, polygon->items, 0, 2);
+        Uint64 hash = hashFloats(14695981039346656037ull, polygon->items, length);
+        if (hash == polygonHash && parts->size > 0) return;
+        polygonHash = hash;
+        buildParts();
+    }
+
+    void SlotClipper::clipEnd(spSlot *slot) {
+        if (clip != 0 && clip->endSlot == slot->data) clipEnd();
+        if (scissor != 0 && scissor->endSlot == slot->data) scissor = 0;
+    }
+
+    void SlotClipper::clipEnd() {
+        clip = 0;
+        scissor = 0;
+    }
+
+    // The convex parts spSkeletonClipping_clipStart() would find, as edge equations. Each part starts with its bounds.
+    void SlotClipper::buildParts() {
+        spIntArray_clear(parts);
+        spFloatArray_clear(edges);
+        // Oriented the way spSkeletonClipping's makeClockwise() leaves it for the triangulator
+        float *vertices = polygon->items;
+        int length = polygon->size;
+        if (getPolygonArea(vertices, length >> 1) >= 0) {
+            for (int i = 0, j = length - 2; i < j; i += 2, j -= 2) {
+                float x = vertices[i], y = vertices[i + 1];
+                vertices[i] = vertices[j];
+                vertices[i + 1] = vertices[j + 1];
+                vertices[j] = x;
+                vertices[j + 1] = y;
+            }
+        }
+        spArrayFloatArray *convex = spTriangulator_decompose(triangulator, polygon, spTriangulator_triangulate(triangulator, polygon));
+        int maxEdges = 0;
+        for (int i = 0; i < convex->size; ++i) {
+            const float *part = convex->items[i]->items;
+            int count = convex->items[i]->size >> 1;
+            float area = count >= 3 ? getPolygonArea(part, count) : 0;
+            if (area == 0) continue;
+            float bounds[4] = {FLT_MAX, FLT_MAX, -FLT_MAX, -FLT_MAX};
+            growBounds(bounds, part, count);
+            spIntArray_add(parts, edges->size / 3);
+            spIntArray_add(parts, count + 4);
+            // x >= min x, y >= min y, x <= max x, y <= max y
+            const float boundEdges[12] = {1, 0, -bounds[0], 0, 1, -bounds[1], -1, 0, bounds[2], 0, -1, bounds[3]};
+            for (int j = 0; j < 12; ++j) spFloatArray_add(edges, boundEdges[j]);
+            // The inner side is on the left of every edge of a counterclockwise polygon
+            float sign = area > 0 ? 1.0f : -1.0f;
+            for (int j = 0; j < count; ++j) {
+                const float *p = part + j * 2, *q = part + (j + 1 == count ? 0 : j + 1) * 2;
+                float dx = q[0] - p[0], dy = q[1] - p[1];
+                spFloatArray_add(edges, -dy * sign);
+                spFloatArray_add(edges, dx * sign);
+                spFloatArray_add(edges, (dy * p[0] - dx * p[1]) * sign);
+            }
+            maxEdges = SDL_max(maxEdges, count);
+        }
+        // Each edge adds a vertex at most to a clipped triangle
+        scratchSize = (3 + maxEdges) * 4;
+        spFloatArray_setSize(scratch, scratchSize * 2);
+    }
+
+    bool SlotClipper::clipTriangles(spSlot *slot, const float *vertices, int count, const unsigned short *triangles, int trianglesCount,
+                                    const float *uvs, bool cache) {
+        Uint64 key = 0;
+        output = &uncached;
+        if (cache) {
+            int index = slot->data->index;
+            if (index >= outputsCapacity) {
+                int capacity = SDL_max(index + 1, outputsCapacity * 2);
+                outputs = REALLOC(outputs, Output *, capacity);
+                for (int i = outputsCapacity; i < capacity; ++i) outputs[i] = 0;
+                outputsCapacity = capacity;
+            }
+            if (outputs[index] == 0) outputs[index] = new Output();
+            output = outputs[index];
+            key = hashFloats(hashFloats(polygonHash, vertices, count * 2), uvs, count * 2);
+            key = (key ^ (Uint64) (size_t) triangles) * 1099511628211ull;
+            key = (key ^ (Uint64) trianglesCount) * 1099511628211ull;
+            if (output->valid && output->key == key) return true;
+        }
+        output->key = key;
+        output->valid = cache;
+        spFloatArray_clear(output->vertices);
+        spFloatArray_clear(output->uvs);
+        spUnsignedShortArray_clear(output->triangles);
+
+        if (count > codesCapacity) {
+            codesCapacity = count;
+            codes = REALLOC(codes, Uint8, codesCapacity);
+            remap = REALLOC(remap, int, codesCapacity);
+        }
+        for (int i = 0; i < count; ++i) remap[i] = -1;
+        for (int p = 0; p < parts->size; p += 2) {
+            const float *partEdges = edges->items + parts->items[p] * 3;
+            int edgeCount = parts->items[p + 1];
+            kernels->classify(vertices, count, partEdges, edgeCount, codes);
+            for (int i = 0; i < trianglesCount; i += 3) {
+                int indices[3] = {triangles[i], triangles[i + 1], triangles[i + 2]};
+                Uint8 c0 = codes[indices[0]], c1 = codes[indices[1]], c2 = codes[indices[2]];
+                // The triangle's bounds miss the part's
+                if ((c0 & c1 & c2 & 15) != 0) continue;
+                if (((c0 | c1 | c2) & 16) != 0) {
+                    clipTriangle(partEdges + 12, edgeCount - 4, vertices, uvs, indices);
+                    continue;
+                }
+                // Entirely inside, its vertices are shared with the other triangles kept whole
+                for (int j = 0; j < 3; ++j) {
+                    int index = indices[j];
+                    if (remap[index] < 0) {
+                        remap[index] = output->vertices->size >> 1;
+                        float vertex[4] = {vertices[index * 2], vertices[index * 2 + 1], uvs[index * 2], uvs[index * 2 + 1]};
+                        addVertex(vertex);
+                    }
+                    spUnsignedShortArray_add(output->triangles, (unsigned short) remap[index]);
+                }
+            }
+        }
+        return false;
+    }
+
+    // Sutherland-Hodgman, one edge of the part at a time, ping-ponging between the halves of scratch. What's left is
+    // added as a triangle fan.
+    void SlotClipper::clipTriangle(const float *partEdges, int edgeCount, const float *vertices, const float *uvs, const int *indices) {
+        float *input = scratch->items, *clipped = input + scratchSize;
+        int maxCount = scratchSize / 4;
+        for (int i = 0; i < 3; ++i) {
+            input[i * 4] = vertices[indices[i] * 2];
+            input[i * 4 + 1] = vertices[indices[i] * 2 + 1];
+            input[i * 4 + 2] = uvs[indices[i] * 2];
+            input[i * 4 + 3] = uvs[indices[i] * 2 + 1];
+        }
+        int count = 3;
+        for (int e = 0; e < edgeCount && count >= 3; ++e) {
+            const float *edge = partEdges + e * 3;
+            int clippedCount = 0;
+            for (int i = 0; i < count && clippedCount + 2 <= maxCount; ++i) {
+                const float *p = input + i * 4, *q = input + (i + 1 == count ? 0 : i + 1) * 4;
+                float dp = edge[0] * p[0] + edge[1] * p[1] + edge[2];
+                float dq = edge[0] * q[0] + edge[1] * q[1] + edge[2];
+                if (dp >= 0) SDL_memcpy(clipped + clippedCount++ * 4, p, 4 * sizeof(float));
+                // Strictly on both sides, a vertex on the edge is kept as is
+                if ((dp > 0 && dq < 0) || (dp < 0 && dq > 0)) {
+                    float t = dp / (dp - dq);
+                    float *v = clipped + clippedCount++ * 4;
+                    for (int k = 0; k < 4; ++k) v[k] = p[k] + (q[k] - p[k]) * t;
+                }
+            }
+            float *swap = input;
+            input = clipped;
+            clipped = swap;
+            count = clippedCount;
+        }
+        if (count < 3) return;
+        int first = output->vertices->size >> 1;
+        for (int i = 0; i < count; ++i) addVertex(input + i * 4);
+        for (int i = 1; i + 1 < count; ++i) {
+            spUnsignedShortArray_add(output->triangles, (unsigned short) first);
+            spUnsignedShortArray_add(output->triangles, (unsigned short) (first + i));
+            spUnsignedShortArray_add(output->triangles, (unsigned short) (first + i + 1));
+        }
+    }
+
+    // x, y, u, v
+    void SlotClipper::addVertex(const float *vertex) {
+        spFloatArray_add(output->vertices, vertex[0]);
+        spFloatArray_add(output->vertices, vertex[1]);
+        spFloatArray_add(output->uvs, vertex[2]);
+        spFloatArray_add(output->uvs, vertex[3]);
+    }
+
+    SwirlEffect::SwirlEffect(float radius, int power, bool powOut)
+    : centerX(0), centerY(0), radius(radius), angle(0), power(power), powOut(powOut), worldX(0), worldY(0) {
+    }
+
+    void SwirlEffect::begin(spSkeleton *skeleton) {
+        worldX = skeleton->x + centerX;
+        worldY = skeleton->y + centerY;
+    }
+
+    void SwirlEffect::transform(float *positions, float *uvs, SDL_Color *colors, int count) {
+        UNUSED(uvs);
+        UNUSED(colors);
+        if (radius <= 0 || angle == 0) return;
+        SwirlParams params = {worldX, worldY, radius, angle * (3.14159265f / 180), power > 1 ? power : 1, powOut};
+        kernels->swirl(positions, count, params);
+    }
+
+    JitterEffect::JitterEffect(float jitterX, float jitterY, Uint32 seed) : jitterX(jitterX), jitterY(jitterY) {
+        // xorshift32 lanes must not start at 0
+        for (int i = 0; i < 4; ++i) state[i] = (seed + i) * 2654435761u | 1;
+    }
+
+    void JitterEffect::transform(float *positions, float *uvs, SDL_Color *colors, int count) {
+        UNUSED(uvs);
+        UNUSED(colors);
+        float amounts[2] = {jitterX, jitterY};
+        kernels->jitter(positions, count, amounts, state);
+    }
+
+    void VertexEffectAdapter::transform(float *positions, float *uvs, SDL_Color *colors, int count) {
+        spColor dark;
+        dark.r = dark.g = dark.b = dark.a = 0;
+        for (int i = 0; i < count; ++i, positions += 2, uvs += 2) {
+            spColor light;
+            light.r = colors[i].r / 255.0f;
+            light.g = colors[i].g / 255.0f;
+            light.b = colors[i].b / 255.0f;
+            light.a = colors[i].a / 255.0f;
+            effect->transform(effect, &positions[0], &positions[1], &uvs[0], &uvs[1], &light, &dark);
+            colors[i].r = static_cast<Uint8>(light.r * 255);
+            colors[i].g = static_cast<Uint8>(light.g * 255);
+            colors[i].b = static_cast<Uint8>(light.b * 255);
+            colors[i].a = static_cast<Uint8>(light.a * 255);
+        }
+    }
+
+    // batchVertexEffect, or vertexEffect through the adapter
+    BatchVertexEffect *SkeletonDrawable::getVertexEffect() const {
+        if (batchVertexEffect != 0) return batchVertexEffect;
+        if (vertexEffect == 0) return 0;
+        effectAdapter->effect = vertexEffect;
+        return effectAdapter;
+    }
+
+    void SkeletonDrawable::draw(SDL_Renderer *renderer) const {
+        if (useGeometryRaw && !hasVertexEffect() && poseCache == 0) {
+            drawRaw(renderer);
+            return;
+        }
+        // Nothing to append to, the cached geometry is submitted as is
+        Uint64 start = SDL_GetPerformanceCounter();
+        RenderStats work;
+        if (!hasSharedPose() && refreshGeometryCache(work)) {
+            setDrawStats(stats, cachedGeometry->stats, RenderStats());
+            moveGeneratedStats(stats, work);
+            stats.buildTicks = SDL_GetPerformanceCounter() - start;
+            submit(renderer, *cachedGeometry, &stats);
+            return;
+        }
+        localBatch->begin(renderer);
+        draw(*localBatch);
+        localBatch->end();
+        stats.drawCalls = localBatch->stats.drawCalls;
+        stats.submitTicks = localBatch->stats.submitTicks;
+    }
+
+    void SkeletonDrawable::draw(SkeletonBatch &batch) const {
+        build(batch);
+    }
+
+    // Same walk over the draw order as buildSkeleton(), minus the vertex effect and culling, but every attachment
+    // is submitted from the buffers its geometry already lives in
+    void SkeletonDrawable::drawRaw(SDL_Renderer *renderer) const {
+        SPINE_SDL_TRACE_SCOPE("SkeletonDrawable::drawRaw");
+        unsigned short quadIndices[6] = {0, 1, 2, 2, 3, 0};
+        resetDrawStats(stats);
+        if (skeleton->color.a == 0) return;
+
+        Uint64 start = SDL_GetPerformanceCounter();
+        SDL_Texture *lastTexture = 0;
+        SDL_BlendMode lastBlendMode = SDL_BLENDMODE_INVALID;
+        RendererClipRect original;
+        original.saved = false;
+        bool scissoring = false, visible = true; // whether the renderer's clip rect is set
+        for (int i = 0; i < skeleton->slotsCount; ++i) {
+            // A rectangular clip range ends where the clipper ended it, once its end slot was drawn
+            if (scissoring && !clipper->isScissoring()) {
+                setRendererClipRect(renderer, 0, original);
+                scissoring = false;
+                visible = true;
+            }
+            spSlot *slot = skeleton->drawOrder[i];
+            spAttachment *attachment = slot->attachment;
+            if (!attachment) continue;
+
+            if (slot->color.a == 0 || !slot->bone->active) {
+                stats.skippedSlots++;
+                clipper->clipEnd(slot);
+                continue;
+            }
+
+            float *vertices = worldVertices;
+            int verticesCount;
+            float *uvs;
+            unsigned short *indices;
+            int indicesCount;
+            spColor *attachmentColor;
+            SDL_Texture *texture;
+            spBone *bone = slot->bone;
+            float transform[6] = {bone->a, bone->b, bone->c, bone->d, bone->worldX, bone->worldY};
+
+            if (attachment->type == SP_ATTACHMENT_REGION) {
+                spRegionAttachment *regionAttachment = (spRegionAttachment *) attachment;
+                attachmentColor = &regionAttachment->color;
+                const float *offset = regionAttachment->offset;
+                float quad[8] = {offset[6], offset[7], offset[0], offset[1], offset[2], offset[3], offset[4], offset[5]};
+                kernels->transform(quad, vertices, 4, transform);
+                verticesCount = 4;
+                uvs = regionAttachment->uvs;
+                indices = quadIndices;
+                indicesCount = 6;
+                texture = (SDL_Texture *) ((spAtlasRegion *) regionAttachment->rendererObject)->page->rendererObject;
+
+            } else if (attachment->type == SP_ATTACHMENT_MESH) {
+                spMeshAttachment *mesh = (spMeshAttachment *) attachment;
+                attachmentColor = &mesh->color;
+                if (mesh->super.worldVerticesLength > SPINE_MESH_VERTEX_COUNT_MAX) continue;
+                verticesCount = mesh->super.worldVerticesLength >> 1;
+                if (mesh->super.bonesCount == 0) {
+                    const float *local = slot->deformCount > 0 ? slot->deform : mesh->super.vertices;
+                    kernels->transform(local, worldVertices, verticesCount, transform);
+                } else
+                    spVertexAttachment_computeWorldVertices(SUPER(mesh), slot, 0, mesh->super.worldVerticesLength, worldVertices, 0, 2);
+                uvs = mesh->uvs;
+                indices = mesh->triangles;
+                indicesCount = mesh->trianglesCount;
+                texture = (SDL_Texture *) ((spAtlasRegion *) mesh->rendererObject)->page->rendererObject;
+
+            } else if (attachment->type == SP_ATTACHMENT_CLIPPING) {
+                spClippingAttachment *clip = (spClippingAttachment *) attachment;
+                SDL_FRect rect;
+                if (clipper->isScissoring() || clipper->isClipping()) continue;
+                if (getClipRectangle(slot, clip, worldVertices, rect)) {
+                    clipper->scissorStart(clip);
+                    scissoring = true;
+                    visible = setRendererClipRect(renderer, &rect, original);
+                } else
+                    clipper->clipStart(slot, clip);
+                continue;
+            } else
+                continue;
+
+            // Transparent, or the page is still loading (see AsyncTextureLoader)
+            if (attachmentColor->a == 0 || texture == 0) {
+                if (attachmentColor->a == 0) stats.skippedSlots++;
+                clipper->clipEnd(slot);
+                continue;
+            }
+
+            if (clipper->isClipping()) {
+                SPINE_SDL_TRACE_SCOPE("SlotClipper::clipTriangles");
+                stats.trianglesBeforeClipping += indicesCount / 3;
+                if (clipper->clipTriangles(slot, vertices, verticesCount, indices, indicesCount, uvs)) stats.clipCacheHits++;
+                vertices = clipper->getClippedVertices()->items;
+                verticesCount = clipper->getClippedVertices()->size >> 1;
+                uvs = clipper->getClippedUVs()->items;
+                indices = clipper->getClippedTriangles()->items;
+                indicesCount = clipper->getClippedTriangles()->size;
+                stats.trianglesAfterClipping += indicesCount / 3;
+            }
+
+            if (indicesCount > 0 && visible) {
+                // SDL_RenderGeometryRaw wants a color per vertex, this run has a single one
+                SDL_Color color = kernels->modulate(&skeleton->color.r, &slot->color.r, &attachmentColor->r);
+                spSDLColorArray_setSize(rawColors, verticesCount);
+                for (int j = 0; j < verticesCount; ++j) rawColors->items[j] = color;
+
+                SDL_BlendMode blendMode = getBlendMode(slot->data->blendMode, usePremultipliedAlpha);
+                if (stats.drawCalls > 0) {
+                    if (texture != lastTexture) stats.textureChanges++;
+                    else if (blendMode != lastBlendMode)
+                        stats.blendModeChanges++;
+                }
+                lastTexture = texture;
+                lastBlendMode = blendMode;
+                stats.drawCalls++;
+                stats.vertices += verticesCount;
+                stats.indices += indicesCount;
+
+                SPINE_SDL_TRACE_SCOPE("SDL_RenderGeometryRaw");
+                SDL_SetTextureBlendMode(texture, blendMode);
+#if SDL_VERSION_ATLEAST(2, 0, 20)
+                const SDL_Color *colors = rawColors->items;
+#else
+                const int *colors = (const int *) rawColors->items;
+#endif
+                SDL_RenderGeometryRaw(renderer, texture, vertices, 2 * sizeof(float), colors, sizeof(SDL_Color),
+                                      uvs, 2 * sizeof(float), verticesCount, indices, indicesCount, sizeof(unsigned short));
+            }
+            clipper->clipEnd(slot);
+        }
+        clipper->clipEnd();
+        if (original.saved) setRendererClipRect(renderer, 0, original);
+        // Building and submitting are interleaved, all of it counts as submitting
+        stats.submitTicks = SDL_GetPerformanceCounter() - start;
+    }
+
+    // FNV-1a over 32-bit words, size is a multiple of 4
+    static Uint64 hashWords(Uint64 hash, const void *data, size_t size) {
+        const Uint8 *bytes = (const Uint8 *) data;
+        for (size_t i = 0; i < size; i += 4) {
+            Uint32 word;
+            SDL_memcpy(&word, bytes + i, sizeof(word));
+            hash = (hash ^ word) * 1099511628211ull;
+        }
+        return hash;
+    }
+
+    // Everything buildSkeleton() reads from the skeleton, except the attachment data itself
+    Uint64 SkeletonDrawable::getPoseSignature() const {
+        Uint64 hash = hashWords(14695981039346656037ull, &skeleton->color, sizeof(spColor));
+        int uploaded = SDL_AtomicGet(&pagesUploaded);
+        hash = hashWords(hash, &uploaded, sizeof(uploaded));
+        for (int i = 0; i < skeleton->bonesCount; ++i) {
+            spBone *bone = skeleton->bones[i];
+            float transform[7] = {bone->a, bone->b, bone->c, bone->d, bone->worldX, bone->worldY, bone->active ? 1.0f : 0.0f};
+            hash = hashWords(hash, transform, sizeof(transform));
+        }
+        for (int i = 0; i < skeleton->slotsCount; ++i) {
+            spSlot *slot = skeleton->drawOrder[i];
+            spAttachment *attachment = slot->attachment;
+            hash = hashWords(hash, &slot, sizeof(spSlot *));
+            hash = hashWords(hash, &attachment, sizeof(spAttachment *));
+            hash = hashWords(hash, &slot->color, sizeof(spColor));
+            if (attachment == 0) continue;
+            if (attachment->type == SP_ATTACHMENT_REGION) {
+                hash = hashWords(hash, &((spRegionAttachment *) attachment)->color, sizeof(spColor));
+            } else if (attachment->type == SP_ATTACHMENT_MESH) {
+                hash = hashWords(hash, &((spMeshAttachment *) attachment)->color, sizeof(spColor));
+                hash = hashWords(hash, slot->deform, slot->deformCount * sizeof(float));
+            }
+        }
+        return hash;
+    }
+
+    bool SkeletonDrawable::refreshGeometryCache(RenderStats &work) const {
+        if (!useGeometryCache || hasVertexEffect()) return false;
+        if (worldStale) {
+            spSkeleton_updateWorldTransform(skeleton);
+            worldStale = false;
+        }
+        // Nothing that could change the geometry ran: no update that posed the skeleton, no setter, no page upload
+        int uploaded = SDL_AtomicGet(&pagesUploaded);
+        if (cacheValid && cachedGeneration == generation && cachedUploads == uploaded) return true;
+        // Only updates ran, and the pose may not have moved (a paused, held or finished animation)
+        Uint64 signature = getPoseSignature();
+        if (cacheValid && cachedDirtyGeneration == dirtyGeneration && cachedSignature == signature) {
+            cachedGeneration = generation;
+            cachedUploads = uploaded;
+            return true;
+        }
+
+        cachedGeometry->clear();
+        buildSkeleton(*cachedGeometry);
+        moveGeneratedStats(work, cachedGeometry->stats);
+        // The cache is built without a viewport, so the bounds have to be updated by hand
+        float noBounds[4] = {FLT_MAX, FLT_MAX, -FLT_MAX, -FLT_MAX};
+        updateBounds(cachedGeometry->vertexArray->items, cachedGeometry->vertexArray->size, noBounds);
+        cachedGeneration = generation;
+        cachedDirtyGeneration = dirtyGeneration;
+        cachedSignature = signature;
+        cachedUploads = uploaded;
+        cacheValid = true;
+        return true;
+    }
+
+    void SkeletonDrawable::build(RenderCommandList &list) const {
+        SPINE_SDL_TRACE_SCOPE("SkeletonDrawable::build");
+        Uint64 start = SDL_GetPerformanceCounter();
+        RenderStats before = list.stats;
+        buildGeometry(list);
+        list.stats.buildTicks += SDL_GetPerformanceCounter() - start;
+        setDrawStats(stats, list.stats, before);
+    }
+
+    void SkeletonDrawable::buildGeometry(RenderCommandList &list) const {
+        if (hasSharedPose()) {
+            buildFromPose(list);
+            return;
+        }
+        // The pose was shared but the cache has been cleared since, so there's nothing left to copy
+        if (worldStale) {
+            spSkeleton_updateWorldTransform(skeleton);
+            worldStale = false;
+        }
+        if (useGeometryCache && !hasVertexEffect()) {
+            // A culled skeleton leaves its cache alone
+            const SDL_FRect *viewport = list.getViewport();
+            culled = viewport != 0 && isOutside(*viewport);
+            if (culled) {
+                list.culledCount++;
+                return;
+            }
+            refreshGeometryCache(list.stats);
+            appendTranslated(list, *cachedGeometry, 0, 0);
+            return;
+        }
+        buildSkeleton(list);
+    }
+
+    // packScalar() with a color per vertex, for vertex effects that change colors
+    static void packColors(SDL_Vertex *vertices, const float *positions, const float *uvs, const SDL_Color *colors, int count) {
+        for (int i = 0; i < count; ++i, positions += 2, uvs += 2) {
+            vertices[i].position.x = positions[0];
+            vertices[i].position.y = positions[1];
+            vertices[i].color = colors[i];
+            vertices[i].tex_coord.x = uvs[0];
+            vertices[i].tex_coord.y = uvs[1];
+        }
+    }
+
+    void SkeletonDrawable::buildSkeleton(RenderCommandList &list) const {
+        spVertexArray *vertexArray = list.vertexArray;
+        spIntArray *indexArray = list.indexArray;
+        unsigned short quadIndices[6] = {0, 1, 2, 2, 3, 0};
+
+        // Early out if skeleton is invisible
+        culled = false;
+        if (skeleton->color.a == 0) return;
+
+        // Early out if the skeleton is outside the viewport
+        const SDL_FRect *viewport = list.getViewport();
+        if (viewport && isOutside(*viewport)) {
+            culled = true;
+            list.culledCount++;
+            return;
+        }
+        int firstBuiltVertex = vertexArray->size;
+        float culledBounds[4] = {FLT_MAX, FLT_MAX, -FLT_MAX, -FLT_MAX};
+
+        BatchVertexEffect *effect = getVertexEffect();
+        if (effect != 0) effect->begin(skeleton);
+
+        SDL_Vertex vertex;
+        SDL_Texture *texture = 0;
+        SDL_FRect scissor;
+        for (int i = 0; i < skeleton->slotsCount; ++i) {
+            spSlot *slot = skeleton->drawOrder[i];
+            spAttachment *attachment = slot->attachment;
+            if (!attachment) continue;
+
+            // Early out if slot is invisible
+            if (slot->color.a == 0 || !slot->bone->active) {
+                list.stats.skippedSlots++;
+                clipper->clipEnd(slot);
+                continue;
+            }
+
+            float *vertices = worldVertices;
+            int verticesCount = 0;
+            float *uvs = 0;
+            unsigned short *indices = 0;
+            int indicesCount = 0;
+            spColor *attachmentColor;
+
+            if (attachment->type == SP_ATTACHMENT_REGION) {
+                spRegionAttachment *regionAttachment = (spRegionAttachment *) attachment;
+                attachmentColor = &regionAttachment->color;
+
+                // Early out if slot is invisible
+                if (attachmentColor->a == 0) {
+                    list.stats.skippedSlots++;
+                    clipper->clipEnd(slot);
+                    continue;
+                }
+
+                // Same corner order as spRegionAttachment_computeWorldVertices(), which the uvs follow
+                const float *offset = regionAttachment->offset;
+                float quad[8] = {offset[6], offset[7], offset[0], offset[1], offset[2], offset[3], offset[4], offset[5]};
+                spBone *bone = slot->bone;
+                float transform[6] = {bone->a, bone->b, bone->c, bone->d, bone->worldX, bone->worldY};
+                kernels->transform(quad, vertices, 4, transform);
+                verticesCount = 4;
+                uvs = regionAttachment->uvs;
+                indices = quadIndices;
+                indicesCount = 6;
+                texture = (SDL_Texture*) ((spAtlasRegion *) regionAttachment->rendererObject)->page->rendererObject;
+
+            } else if (attachment->type == SP_ATTACHMENT_MESH) {
+                spMeshAttachment *mesh = (spMeshAttachment *) attachment;
+                attachmentColor = &mesh->color;
+
+                // Early out if slot is invisible
+                if (attachmentColor->a == 0) {
+                    list.stats.skippedSlots++;
+                    clipper->clipEnd(slot);
+                    continue;
+                }
+
+                if (mesh->super.worldVerticesLength > SPINE_MESH_VERTEX_COUNT_MAX) continue;
+                texture = (SDL_Texture*) ((spAtlasRegion *) mesh->rendererObject)->page->rendererObject;
+                verticesCount = mesh->super.worldVerticesLength >> 1;
+                if (mesh->super.bonesCount == 0) {
+                    // Not weighted, every vertex follows the slot's bone (like spVertexAttachment_computeWorldVertices())
+                    const float *local = slot->deformCount > 0 ? slot->deform : mesh->super.vertices;
+                    spBone *bone = slot->bone;
+                    float transform[6] = {bone->a, bone->b, bone->c, bone->d, bone->worldX, bone->worldY};
+                    kernels->transform(local, worldVertices, verticesCount, transform);
+                } else
+                    spVertexAttachment_computeWorldVertices(SUPER(mesh), slot, 0, mesh->super.worldVerticesLength, worldVertices, 0, 2);
+                uvs = mesh->uvs;
+                indices = mesh->triangles;
+                indicesCount = mesh->trianglesCount;
+
+            } else if (attachment->type == SP_ATTACHMENT_CLIPPING) {
+                spClippingAttachment *clip = (spClippingAttachment *) slot->attachment;
+                if (clipper->isScissoring() || clipper->isClipping()) continue;
+                // Rectangles are left to the renderer's clip rect, unless a vertex effect moves the clipped vertices
+                if (effect == 0 && getClipRectangle(slot, clip, worldVertices, scissor))
+                    clipper->scissorStart(clip);
+                else
+                    clipper->clipStart(slot, clip);
+                continue;
+            } else
+                continue;
+
+            // Early out if the page is still loading (see AsyncTextureLoader)
+            if (texture == 0) {
+                clipper->clipEnd(slot);
+                continue;
+            }
+
+            // Early out if the attachment is outside the viewport. Vertex effects can move vertices anywhere,
+            // so attachments are only culled without one.
+            if (cullAttachments && viewport && effect == 0) {
+                float attachmentBounds[4] = {FLT_MAX, FLT_MAX, -FLT_MAX, -FLT_MAX};
+                growBounds(attachmentBounds, worldVertices, verticesCount);
+                if (missesViewport(attachmentBounds, *viewport)) {
+                    growBounds(culledBounds, attachmentBounds, 2);
+                    clipper->clipEnd(slot);
+                    continue;
+                }
+            }
+
+            vertex.color = kernels->modulate(&skeleton->color.r, &slot->color.r, &attachmentColor->r);
+
+            SDL_BlendMode blend = getBlendMode(slot->data->blendMode, usePremultipliedAlpha);
+
+            if (clipper->isClipping()) {
+                SPINE_SDL_TRACE_SCOPE("SlotClipper::clipTriangles");
+                list.stats.trianglesBeforeClipping += indicesCount / 3;
+                // The vertex effect below modifies the clipped vertices, so they can't be kept
+                if (clipper->clipTriangles(slot, vertices, verticesCount, indices, indicesCount, uvs, effect == 0))
+                    list.stats.clipCacheHits++;
+                vertices = clipper->getClippedVertices()->items;
+                verticesCount = clipper->getClippedVertices()->size >> 1;
+                uvs = clipper->getClippedUVs()->items;
+                indices = clipper->getClippedTriangles()->items;
+                indicesCount = clipper->getClippedTriangles()->size;
+                list.stats.trianglesAfterClipping += indicesCount / 3;
+            }
+
+            // Nothing left after clipping
+            if (indicesCount == 0) {
+                clipper->clipEnd(slot);
+                continue;
+            }
+
+            // Each unique vertex is emitted once, the indices are rebased onto the current run of the list
+            int firstVertex = vertexArray->size;
+            int firstIndex = indexArray->size;
+            int indexOffset = list.add(texture, blend, verticesCount, indicesCount, clipper->isScissoring() ? &scissor : 0);
+            if (effect != 0) {
+                SPINE_SDL_TRACE_SCOPE("BatchVertexEffect::transform");
+                // worldVertices, or clipper output that wasn't cached, so the effect may write to it
+                if (effect->movesOnly()) {
+                    effect->transform(vertices, 0, 0, verticesCount);
+                    kernels->pack(vertexArray->items + firstVertex, vertices, uvs, verticesCount, vertex.color);
+                } else {
+                    spFloatArray_clear(tempUvs);
+                    spFloatArray_addAllValues(tempUvs, uvs, 0, verticesCount << 1);
+                    spSDLColorArray_setSize(tempColors, verticesCount);
+                    for (int j = 0; j < verticesCount; ++j) tempColors->items[j] = vertex.color;
+                    effect->transform(vertices, tempUvs->items, tempColors->items, verticesCount);
+                    packColors(vertexArray->items + firstVertex, vertices, tempUvs->items, tempColors->items, verticesCount);
+                }
+            } else
+                kernels->pack(vertexArray->items + firstVertex, vertices, uvs, verticesCount, vertex.color);
+            for (int j = 0; j < indicesCount; ++j)
+                indexArray->items[firstIndex + j] = indexOffset + indices[j];
+
+            clipper->clipEnd(slot);
+        }
+
+        clipper->clipEnd();
+
+        if (effect != 0) effect->end();
+
+        if (viewport) updateBounds(vertexArray->items + firstBuiltVertex, vertexArray->size - firstBuiltVertex, culledBounds);
+    }
+
+    // The vertices of the last build are stale as soon as the skeleton moves, so the estimate is the current
+    // bone bounds grown by how far the vertices reached past the bones back then. It follows the skeleton around
+    // even while it stays culled and never needs the vertices to be generated.
+    bool SkeletonDrawable::isOutside(const SDL_FRect &viewport) const {
+        float estimate[4];
+        if (!hasBounds || !getBoneBounds(skeleton, estimate)) return false;
+        for (int i = 0; i < 4; ++i) estimate[i] += i < 2 ? -boundsPadding[i] : boundsPadding[i];
+        return missesViewport(estimate, viewport);
+    }
+
+    // Attachments culled by the viewport still count, otherwise the estimate would shrink to the visible part
+    void SkeletonDrawable::updateBounds(const SDL_Vertex *vertices, int count, const float *culledBounds) const {
+        float vertexBounds[4] = {culledBounds[0], culledBounds[1], culledBounds[2], culledBounds[3]};
+        for (int i = 0; i < count; ++i) growBounds(vertexBounds, &vertices[i].position.x, 1);
+        float boneBounds[4];
+        hasBounds = vertexBounds[0] <= vertexBounds[2] && getBoneBounds(skeleton, boneBounds);
+        if (!hasBounds) return;
+        bounds.x = vertexBounds[0];
+        bounds.y = vertexBounds[1];
+        bounds.w = vertexBounds[2] - vertexBounds[0];
+        bounds.h = vertexBounds[3] - vertexBounds[1];
+        for (int i = 0; i < 4; ++i)
+            boundsPadding[i] = SDL_max(0.0f, i < 2 ? boneBounds[i] - vertexBounds[i] : vertexBounds[i] - boneBounds[i]);
+    }
+
+    bool SkeletonDrawable::makePoseKey(PoseCache::Key &key) const {
+        // A vertex effect or a blended pose makes every drawable unique
+        if (hasVertexEffect() || (updateInterval > 1 && bonesTo->size > 0)) return false;
+        // Keys are compared as bytes, padding included
+        SDL_memset(&key, 0, sizeof(key));
+        key.data = skeleton->data;
+        key.skin = skeleton->skin;
+        key.scaleX = skeleton->scaleX;
+        key.scaleY = skeleton->scaleY;
+        spColor &color = skeleton->color;
+        key.premultipliedAlpha = usePremultipliedAlpha;
+        key.cullAttachments = cullAttachments;
+        key.color = (Uint32) (color.r * 255) << 24 | (Uint32) (color.g * 255) << 16 | (Uint32) (color.b * 255) << 8 | (Uint32) (color.a * 255);
+        for (int i = 0; i < state->tracksCount; ++i) {
+            spTrackEntry *entry = state->tracks[i];
+            if (entry == 0) continue;
+            // Mixes and partial tracks are applied on top of whatever pose each drawable had before
+            if (entry->mixingFrom != 0 || entry->alpha < 1 || key.trackCount == PoseCache::maxTracks) return false;
+            key.trackIndices[key.trackCount] = i;
+            key.frames[key.trackCount] = (int) SDL_floorf(spTrackEntry_getAnimationTime(entry) * poseCache->fps);
+            key.animations[key.trackCount] = entry->animation;
+            key.trackCount++;
+        }
+        return true;
+    }
+
+    // Called by the owner of a pose from its own update(), so the owner's skeleton and scratch buffers are only ever
+    // touched by the thread updating it. Sharers read the geometry once the entry is unlocked.
+    void SkeletonDrawable::buildPose() {
+        SPINE_SDL_TRACE_SCOPE("SkeletonDrawable::buildPose");
+        PoseCache::Entry &entry = *pose;
+        entry.geometry.clear();
+        buildSkeleton(entry.geometry);
+        float x = skeleton->x, y = skeleton->y;
+        entry.bounds[0] = entry.bounds[1] = 0;
+        entry.bounds[2] = entry.bounds[3] = 0;
+        for (int i = 0; i < entry.geometry.vertexArray->size; ++i) {
+            SDL_Vertex &vertex = entry.geometry.vertexArray->items[i];
+            vertex.position.x -= x;
+            vertex.position.y -= y;
+            if (i == 0) {
+                entry.bounds[0] = entry.bounds[2] = vertex.position.x;
+                entry.bounds[1] = entry.bounds[3] = vertex.position.y;
+            } else
+                growBounds(entry.bounds, &vertex.position.x, 1);
+        }
+        for (int i = 0; i < entry.geometry.commands->size; ++i) {
+            entry.geometry.commands->items[i].clipRect.x -= x;
+            entry.geometry.commands->items[i].clipRect.y -= y;
+        }
+        SDL_AtomicUnlock(&entry.lock);
+    }
+
+    void SkeletonDrawable::buildFromPose(RenderCommandList &list) const {
+        PoseCache::Entry &entry = *pose;
+        // Only waits if the owner is still being updated on another thread
+        SDL_AtomicLock(&entry.lock);
+        SDL_AtomicUnlock(&entry.lock);
+        // The clipping stats of the pose go to the owner's build, sharers only copy
+        if (entry.owner == this) moveGeneratedStats(list.stats, entry.geometry.stats);
+
+        float x = skeleton->x, y = skeleton->y;
+        float poseBounds[4] = {entry.bounds[0] + x, entry.bounds[1] + y, entry.bounds[2] + x, entry.bounds[3] + y};
+        bounds.x = poseBounds[0];
+        bounds.y = poseBounds[1];
+        bounds.w = poseBounds[2] - poseBounds[0];
+        bounds.h = poseBounds[3] - poseBounds[1];
+        const SDL_FRect *viewport = list.getViewport();
+        culled = viewport && missesViewport(poseBounds, *viewport);
+        if (culled) {
+            list.culledCount++;
+            return;
+        }
+        appendTranslated(list, entry.geometry, x, y);
+    }
+
+    PoseCache::PoseCache(float fps) : fps(fps), generation(0), lock(0), entries(0), entriesCapacity(0), used(0), shared(0) {
+        table = spIntArray_create(64);
+    }
+
+    PoseCache::~PoseCache() {
+        for (int i = 0; i < entriesCapacity; ++i) delete entries[i];
+        FREE(entries);
+        spIntArray_dispose(table);
+    }
+
+    void PoseCache::clear() {
+        generation++;
+        used = 0;
+        shared = 0;
+        for (int i = 0; i < table->size; ++i) table->items[i] = 0;
+    }
+
+    PoseCache::Entry *PoseCache::acquire(const Key &key, const SkeletonDrawable *drawable, bool &created) {
+        // FNV-1a
+        Uint32 hash = 2166136261u;
+        const Uint8 *bytes = (const Uint8 *) &key;
+        for (size_t i = 0; i < sizeof(Key); ++i) hash = (hash ^ bytes[i]) * 16777619u;
+
+        SDL_AtomicLock(&lock);
+        if ((used + 1) * 2 > table->size) rehash(SDL_max(64, table->size * 2));
+        int mask = table->size - 1;
+        int slot = (int) (hash & mask);
+        for (; table->items[slot] != 0; slot = (slot + 1) & mask) {
+            Entry *entry = entries[table->items[slot] - 1];
+            if (entry->hash == hash && SDL_memcmp(&entry->key, &key, sizeof(Key)) == 0) {
+                shared++;
+                SDL_AtomicUnlock(&lock);
+                created = false;
+                return entry;
+            }
+        }
+        if (used == entriesCapacity) {
+            entriesCapacity = SDL_max(16, entriesCapacity * 2);
+            entries = REALLOC(entries, Entry *, entriesCapacity);
+            for (int i = used; i < entriesCapacity; ++i) entries[i] = new Entry();
+        }
+        Entry *entry = entries[used++];
+        SDL_memcpy(&entry->key, &key, sizeof(Key));
+        entry->hash = hash;
+        entry->owner = drawable;
+        entry->lock = 0;
+        SDL_AtomicLock(&entry->lock);
+        table->items[slot] = used;
+        SDL_AtomicUnlock(&lock);
+        created = true;
+        return entry;
+    }
+
+    void PoseCache::rehash(int size) {
+        spIntArray_setSize(table, size);
+        for (int i = 0; i < size; ++i) table->items[i] = 0;
+        for (int i = 0; i < used; ++i) {
+            int slot = (int) (entries[i]->hash & (size - 1));
+            while (table->items[slot] != 0) slot = (slot + 1) & (size - 1);
+            table->items[slot] = i + 1;
+        }
+    }
+
+    BakedAnimation::BakedAnimation(spSkeletonData *skeletonData, const char *animationName, float fps, const char *skinName,
+                                   bool usePremultipliedAlpha) : fps(fps), duration(0) {
+        frames = spBakedFrameArray_create(16);
+        commands = spRenderCommandArray_create(16);
+        vertices = spBakedVertexArray_create(SPINE_MESH_VERTEX_COUNT_MAX);
+        indices = spUnsignedShortArray_create(SPINE_MESH_VERTEX_COUNT_MAX * 3);
+
+        spAnimation *animation = spSkeletonData_findAnimation(skeletonData, animationName);
+        if (!animation) {
+            SDL_Log("spine-sdl: can't bake %s, animation not found", animationName);
+            return;
+        }
+        duration = animation->duration;
+        int frameCount = SDL_max(1, (int) SDL_ceilf(duration * fps));
+
+        SkeletonDrawable drawable(skeletonData);
+        drawable.setUsePremultipliedAlpha(usePremultipliedAlpha);
+        if (skinName) spSkeleton_setSkinByName(drawable.skeleton, skinName);
+        RenderCommandList list;
+        for (int i = 0; i < frameCount; ++i) {
+            spSkeleton_setToSetupPose(drawable.skeleton);
+            spAnimation_apply(animation, drawable.skeleton, 0, i / fps, 1, 0, 0, 1, SP_MIX_BLEND_SETUP, SP_MIX_DIRECTION_IN);
+            spSkeleton_updateWorldTransform(drawable.skeleton);
+            list.clear();
+            drawable.build(list);
+
+            BakedFrame frame;
+            frame.firstCommand = commands->size;
+            frame.commandCount = 0;
+            frame.bounds[0] = frame.bounds[1] = FLT_MAX;
+            frame.bounds[2] = frame.bounds[3] = -FLT_MAX;
+            for (int ii = 0; ii < list.vertexArray->size; ++ii)
+                growBounds(frame.bounds, &list.vertexArray->items[ii].position.x, 1);
+            float extent = SDL_max(SDL_max(-frame.bounds[0], -frame.bounds[1]), SDL_max(frame.bounds[2], frame.bounds[3]));
+            frame.scale = extent > 0 ? extent / 32767 : 1;
+            if (list.vertexArray->size == 0) frame.bounds[0] = frame.bounds[1] = frame.bounds[2] = frame.bounds[3] = 0;
+
+            for (int ii = 0; ii < list.commands->size; ++ii) {
+                RenderCommand command = list.commands->items[ii];
+                if (command.indexCount == 0) continue;
+                if (command.vertexCount > 65536) {
+                    SDL_Log("spine-sdl: can't bake a run of %d vertices, skipping it", command.vertexCount);
+                    continue;
+                }
+                const SDL_Vertex *source = list.vertexArray->items + command.firstVertex;
+                const int *sourceIndices = list.indexArray->items + command.firstIndex;
+                command.firstVertex = vertices->size;
+                command.firstIndex = indices->size;
+                spBakedVertexArray_setSize(vertices, vertices->size + command.vertexCount);
+                spUnsignedShortArray_setSize(indices, indices->size + command.indexCount);
+
+                BakedVertex *baked = vertices->items + command.firstVertex;
+                for (int iii = 0; iii < command.vertexCount; ++iii) {
+                    baked[iii].x = (Sint16) SDL_lroundf(source[iii].position.x / frame.scale);
+                    baked[iii].y = (Sint16) SDL_lroundf(source[iii].position.y / frame.scale);
+                    baked[iii].u = (Uint16) SDL_lroundf(SDL_clamp(source[iii].tex_coord.x, 0.0f, 1.0f) * 65535);
+                    baked[iii].v = (Uint16) SDL_lroundf(SDL_clamp(source[iii].tex_coord.y, 0.0f, 1.0f) * 65535);
+                    baked[iii].color = source[iii].color;
+                }
+                unsigned short *bakedIndices = indices->items + command.firstIndex;
+                for (int iii = 0; iii < command.indexCount; ++iii)
+                    bakedIndices[iii] = (unsigned short) sourceIndices[iii];
+
+                spRenderCommandArray_add(commands, command);
+                frame.commandCount++;
+            }
+            spBakedFrameArray_add(frames, frame);
+        }
+    }
+
+    BakedAnimation::~BakedAnimation() {
+        spBakedFrameArray_dispose(frames);
+        spRenderCommandArray_dispose(commands);
+        spBakedVertexArray_dispose(vertices);
+        spUnsignedShortArray_dispose(indices);
+    }
+
+    void BakedAnimation::build(RenderCommandList &list, int frameIndex, float x, float y) const {
+        if (frames->size == 0) return;
+        frameIndex %= frames->size;
+        if (frameIndex < 0) frameIndex += frames->size;
+        const BakedFrame &frame = frames->items[frameIndex];
+
+        const SDL_FRect *viewport = list.getViewport();
+        if (viewport) {
+            float bounds[4] = {frame.bounds[0] + x, frame.bounds[1] + y, frame.bounds[2] + x, frame.bounds[3] + y};
+            if (missesViewport(bounds, *viewport)) {
+                list.culledCount++;
+                return;
+            }
+        }
+
+        const float uvScale = 1.0f / 65535;
+        for (int i = 0; i < frame.commandCount; ++i) {
+            const RenderCommand &command = commands->items[frame.firstCommand + i];
+            int firstVertex = list.vertexArray->size;
+            int firstIndex = list.indexArray->size;
+            SDL_FRect clipRect;
+            int indexOffset = list.add(command.texture, command.blendMode, command.vertexCount, command.indexCount,
+                                       translateClipRect(command, x, y, clipRect));
+
+            const BakedVertex *source = vertices->items + command.firstVertex;
+            SDL_Vertex *vertex = list.vertexArray->items + firstVertex;
+            for (int ii = 0; ii < command.vertexCount; ++ii, ++vertex) {
+                vertex->position.x = source[ii].x * frame.scale + x;
+                vertex->position.y = source[ii].y * frame.scale + y;
+                vertex->tex_coord.x = source[ii].u * uvScale;
+                vertex->tex_coord.y = source[ii].v * uvScale;
+                vertex->color = source[ii].color;
+            }
+            const unsigned short *sourceIndices = indices->items + command.firstIndex;
+            int *index = list.indexArray->items + firstIndex;
+            for (int ii = 0; ii < command.indexCount; ++ii)
+                index[ii] = indexOffset + sourceIndices[ii];
+        }
+    }
+
+    BakedDrawable::BakedDrawable(BakedAnimation *animation) : animation(animation), x(0), y(0), time(0), timeScale(1) {
+    }
+
+    void BakedDrawable::update(float deltaTime) {
+        time += deltaTime * timeScale;
+        // Kept within one loop so the time doesn't lose precision after a long run
+        float duration = animation->getDuration();
+        if (duration > 0 && (time >= duration || time < 0)) time = SDL_fmodf(time, duration) + (time < 0 ? duration : 0);
+    }
+
+    int BakedDrawable::getFrame() const {
+        return (int) (time * animation->getFps());
+    }
+
+    // The formats textures are converted to and bundles are stored in: 32 bits per pixel, with alpha
+    static bool isAlphaFormat32(Uint32 format) {
+        return SDL_strcmp(SDL_GetPixelFormatName(format), "SDL_PIXELFORMAT_UNKNOWN") != 0 && !SDL_ISPIXELFORMAT_FOURCC(format) &&
+               SDL_ISPIXELFORMAT_ALPHA(format) && SDL_BITSPERPIXEL(format) == 32;
+    }
+
+    // The first 32-bit format with alpha the renderer lists, ARGB8888 if none
+    static Uint32 getNativeFormat(SDL_Renderer *renderer) {
+        SDL_RendererInfo info;
+        if (SDL_GetRendererInfo(renderer, &info) == 0) {
+            for (Uint32 i = 0; i < info.num_texture_formats; ++i) {
+                Uint32 format = info.texture_formats[i];
+                if (isAlphaFormat32(format)) return format;
+            }
+        }
+        return SDL_PIXELFORMAT_ARGB8888;
+    }
+
+    // Converts and premultiplies the image as the options ask, then uploads it to a STATIC texture
+    static SDL_Texture *createTexture(SDL_Renderer *renderer, SDL_Surface *surface, Uint32 options) {
+        if (options == 0) return SDL_CreateTextureFromSurface(renderer, surface);
+        // Premultiplying needs 32-bit pixels with alpha and a copy it can write to
+        Uint32 format = options & TextureOptions_NativeFormat ? getNativeFormat(renderer) : SDL_PIXELFORMAT_ARGB8888;
+        bool premultiply = (options & TextureOptions_PremultiplyAlpha) != 0;
+        SDL_Surface *converted = surface;
+        if (premultiply || surface->format->format != format) converted = SDL_ConvertSurfaceFormat(surface, format, 0);
+        if (!converted) return NULL;
+
+        SDL_LockSurface(converted);
+        if (premultiply) {
+            for (int y = 0; y < converted->h; ++y) {
+                Uint32 *row = (Uint32 *) ((Uint8 *) converted->pixels + y * converted->pitch);
+                kernels->premultiply(row, converted->w, converted->format->Ashift);
+            }
+        }
+        SDL_Texture *texture = SDL_CreateTexture(renderer, format, SDL_TEXTUREACCESS_STATIC, converted->w, converted->h);
+        if (texture) {
+            SDL_UpdateTexture(texture, NULL, converted->pixels, converted->pitch);
+            SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+        }
+        SDL_UnlockSurface(converted);
+        if (converted != surface) SDL_FreeSurface(converted);
+        return texture;
+    }
+
+    // Pages exported with pma are never premultiplied again
+    static Uint32 getPageOptions(Uint32 options, bool pma) {
+        return pma ? options & ~(Uint32) TextureOptions_PremultiplyAlpha : options;
+    }
+
+    struct RegisteredTexture {
+        char *path;
+        SDL_Renderer *renderer;
+        Uint32 options;
+        SDL_Texture *texture;
+        int references;
+    };
+
+    // Few enough textures to search linearly
+    static RegisteredTexture **registeredTextures = 0;
+    static int registeredCount = 0, registeredCapacity = 0;
+    static SDL_SpinLock registryLock;
+
+    // Returns a copy to FREE
+    static char *resolvePath(const char *path) {
+#ifdef _WIN32
+        char *resolved = _fullpath(0, path, 0);
+#else
+        char *resolved = realpath(path, 0);
+#endif
+        // Paths that don't resolve (e.g. Android assets) are used as given
+        char *result;
+        MALLOC_STR(result, resolved ? resolved : path);
+        free(resolved);
+        return result;
+    }
+
+    // Adds a reference to a registered texture, call with the lock held
+    static SDL_Texture *findRegistered(SDL_Renderer *renderer, const char *path, Uint32 options) {
+        for (int i = 0; i < registeredCount; ++i) {
+            RegisteredTexture *entry = registeredTextures[i];
+            if (entry->renderer == renderer && entry->options == options && strcmp(entry->path, path) == 0) {
+                entry->references++;
+                return entry->texture;
+            }
+        }
+        return 0;
+    }
+
+    SDL_Texture *TextureRegistry::acquire(SDL_Renderer *renderer, const char *path, Uint32 options) {
+        SDL_Texture *texture = find(renderer, path, options);
+        if (texture) return texture;
+        SDL_Surface *img = IMG_Load(path);
+        if (!img) return 0;
+        texture = add(renderer, path, options, img);
+        SDL_FreeSurface(img);
+        return texture;
+    }
+
+    SDL_Texture *TextureRegistry::find(SDL_Renderer *renderer, const char *path, Uint32 options) {
+        char *resolved = resolvePath(path);
+        SDL_AtomicLock(&registryLock);
+        SDL_Texture *texture = findRegistered(renderer, resolved, options);
+        SDL_AtomicUnlock(&registryLock);
+        FREE(resolved);
+        return texture;
+    }
+
+    SDL_Texture *TextureRegistry::add(SDL_Renderer *renderer, const char *path, Uint32 options, SDL_Surface *surface) {
+        char *resolved = resolvePath(path);
+        SDL_AtomicLock(&registryLock);
+        SDL_Texture *texture = findRegistered(renderer, resolved, options);
+        SDL_AtomicUnlock(&registryLock);
+        if (texture) {
+            FREE(resolved);
+            return texture;
+        }
+
+        texture = createTexture(renderer, surface, options);
+        if (!texture) {
+            FREE(resolved);
+            return 0;
+        }
+
+        // Another thread may have registered the same image meanwhile
+        SDL_AtomicLock(&registryLock);
+        SDL_Texture *registered = findRegistered(renderer, resolved, options);
+        if (!registered) {
+            if (registeredCount == registeredCapacity) {
+                registeredCapacity = registeredCapacity * 2 + 8;
+                registeredTextures = REALLOC(registeredTextures, RegisteredTexture *, registeredCapacity);
+            }
+            RegisteredTexture *entry = new RegisteredTexture();
+            entry->path = resolved;
+            entry->renderer = renderer;
+            entry->options = options;
+            entry->texture = texture;
+            entry->references = 1;
+            registeredTextures[registeredCount++] = entry;
+        }
+        SDL_AtomicUnlock(&registryLock);
+        if (registered) {
+            FREE(resolved);
+            SDL_DestroyTexture(texture);
+            return registered;
+        }
+        return texture;
+    }
+
+    void TextureRegistry::release(SDL_Texture *texture) {
+        if (texture == 0) return;
+        bool destroy = true;
+        SDL_AtomicLock(&registryLock);
+        for (int i = 0; i < registeredCount; ++i) {
+            RegisteredTexture *entry = registeredTextures[i];
+            if (entry->texture != texture) continue;
+            if (--entry->references > 0) {
+                destroy = false;
+            } else {
+                FREE(entry->path);
+                delete entry;
+                registeredTextures[i] = registeredTextures[--registeredCount];
+            }
+            break;
+        }
+        SDL_AtomicUnlock(&registryLock);
+        if (destroy) SDL_DestroyTexture(texture);
+    }
+
+    int TextureRegistry::getReferenceCount(SDL_Texture *texture) {
+        int references = 0;
+        SDL_AtomicLock(&registryLock);
+        for (int i = 0; i < registeredCount; ++i)
+            if (registeredTextures[i]->texture == texture) references = registeredTextures[i]->references;
+        SDL_AtomicUnlock(&registryLock);
+        return references;
+    }
+
+    int TextureRegistry::getTextureCount() {
+        SDL_AtomicLock(&registryLock);
+        int count = registeredCount;
+        SDL_AtomicUnlock(&registryLock);
+        return count;
+    }
+
+    void setAtlasTextureOptions(Uint32 options) {
+        atlasTextureOptions = options;
+    }
+
+    static AsyncTextureLoader *currentLoader = 0;
+
+    void AsyncTextureLoader::setCurrent(AsyncTextureLoader *loader) {
+        currentLoader = loader;
+    }
+
+    AsyncTextureLoader *AsyncTextureLoader::getCurrent() {
+        return currentLoader;
+    }
+
+    AsyncTextureLoader::AsyncTextureLoader(SDL_Renderer *renderer, int workerCount, Uint32 options)
+    : renderer(renderer), options(options), threadCount(0), queuedHead(0), queuedTail(0), decodedHead(0), decodedTail(0),
+      pending(0), quit(false) {
+        mutex = SDL_CreateMutex();
+        queuedCond = SDL_CreateCond();
+        decodedCond = SDL_CreateCond();
+        threads = CALLOC(SDL_Thread *, workerCount > 0 ? workerCount : 1);
+        for (int i = 0; i < workerCount; ++i) {
+            // Without threads load() decodes on the spot and pump() only uploads
+            threads[i] = SDL_CreateThread(decodeMain, "spine-decode", this);
+            if (!threads[i]) break;
+            threadCount++;
+        }
+    }
+
+    AsyncTextureLoader::~AsyncTextureLoader() {
+        if (currentLoader == this) currentLoader = 0;
+        SDL_LockMutex(mutex);
+        quit = true;
+        SDL_CondBroadcast(queuedCond);
+        SDL_UnlockMutex(mutex);
+        for (int i = 0; i < threadCount; ++i) SDL_WaitThread(threads[i], 0);
+        FREE(threads);
+
+        Job *lists[2] = {queuedHead, decodedHead};
+        for (int i = 0; i < 2; ++i) {
+            for (Job *job = lists[i]; job != 0;) {
+                Job *next = job->next;
+                if (job->surface) SDL_FreeSurface(job->surface);
+                FREE(job->path);
+                delete job;
+                job = next;
+            }
+        }
+        SDL_DestroyCond(decodedCond);
+        SDL_DestroyCond(queuedCond);
+        SDL_DestroyMutex(mutex);
+    }
+
+    void AsyncTextureLoader::load(spAtlasPage *page, const char *path) {
+        // Pages some other atlas already loaded are ready right away
+        Uint32 pageOptions = getPageOptions(options, page->pma != 0);
+        SDL_Texture *texture = TextureRegistry::find(renderer, path, pageOptions);
+        if (texture) {
+            page->rendererObject = texture;
+            SDL_QueryTexture(texture, 0, 0, &page->width, &page->height);
+            if (pageOptions & TextureOptions_PremultiplyAlpha) page->pma = 1;
+            return;
+        }
+        page->rendererObject = 0;
+        Job *job = new Job();
+        job->page = page;
+        MALLOC_STR(job->path, path);
+        job->surface = threadCount == 0 ? IMG_Load(path) : 0;
+        job->next = 0;
+
+        SDL_LockMutex(mutex);
+        pending++;
+        Job *&head = threadCount == 0 ? decodedHead : queuedHead;
+        Job *&tail = threadCount == 0 ? decodedTail : queuedTail;
+        if (tail) tail->next = job;
+        else head = job;
+        tail = job;
+        SDL_CondSignal(queuedCond);
+        SDL_UnlockMutex(mutex);
+    }
+
+    int AsyncTextureLoader::decodeMain(void *data) {
+        AsyncTextureLoader *loader = (AsyncTextureLoader *) data;
+        SDL_LockMutex(loader->mutex);
+        while (true) {
+            while (!loader->quit && loader->queuedHead == 0) SDL_CondWait(loader->queuedCond, loader->mutex);
+            if (loader->quit) break;
+            Job *job = loader->queuedHead;
+            loader->queuedHead = job->next;
+            if (loader->queuedHead == 0) loader->queuedTail = 0;
+            job->next = 0;
+            SDL_UnlockMutex(loader->mutex);
+
+            job->surface = IMG_Load(job->path);
+
+            SDL_LockMutex(loader->mutex);
+            if (loader->decodedTail) loader->decodedTail->next = job;
+            else loader->decodedHead = job;
+            loader->decodedTail = job;
+            SDL_CondSignal(loader->decodedCond);
+        }
+        SDL_UnlockMutex(loader->mutex);
+        return 0;
+    }
+
+    void AsyncTextureLoader::upload(Job *job) {
+        if (!job->surface) {
+            printf("Error loading image: %s\n", job->path);
+        } else {
+            Uint32 pageOptions = getPageOptions(options, job->page->pma != 0);
+            SDL_Texture *texture = TextureRegistry::add(renderer, job->path, pageOptions, job->surface);
+            job->page->rendererObject = texture;
+            if (texture && (pageOptions & TextureOptions_PremultiplyAlpha)) job->page->pma = 1;
+            job->page->width = job->surface->w;
+            job->page->height = job->surface->h;
+            SDL_FreeSurface(job->surface);
+            SDL_AtomicIncRef(&pagesUploaded);
+        }
+        FREE(job->path);
+        delete job;
+    }
+
+    int AsyncTextureLoader::pump(Uint32 budgetMs) {
+        Uint64 start = SDL_GetPerformanceCounter();
+        Uint64 budget = SDL_GetPerformanceFrequency() * budgetMs / 1000;
+        SDL_LockMutex(mutex);
+        while (decodedHead != 0) {
+            Job *job = decodedHead;
+            decodedHead = job->next;
+            if (decodedHead == 0) decodedTail = 0;
+            pending--;
+            SDL_UnlockMutex(mutex);
+            upload(job);
+            SDL_LockMutex(mutex);
+            if (SDL_GetPerformanceCounter() - start >= budget) break;
+        }
+        int left = pending;
+        SDL_UnlockMutex(mutex);
+        return left;
+    }
+
+    void AsyncTextureLoader::finish() {
+        while (pump(SDL_MAX_UINT32) > 0) {
+            SDL_LockMutex(mutex);
+            while (decodedHead == 0) SDL_CondWait(decodedCond, mutex);
+            SDL_UnlockMutex(mutex);
+        }
+    }
+
+    int AsyncTextureLoader::getPendingCount() const {
+        SDL_LockMutex(mutex);
+        int count = pending;
+        SDL_UnlockMutex(mutex);
+        return count;
+    }
+
+    MappedFile::MappedFile(const char *path) : data(0), length(0), mapped(false) {
+#ifdef SPINE_SDL_MMAP
+        int fd = open(path, O_RDONLY);
+        if (fd >= 0) {
+            struct stat info;
+            // The bytes past the end of the file up to the page boundary read as zeroes, which NUL-terminates the
+            // mapping unless the file fills its last page
+            if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0 && info.st_size < INT_MAX &&
+                info.st_size % sysconf(_SC_PAGESIZE) != 0) {
+                void *mapping = mmap(0, (size_t) info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (mapping != MAP_FAILED) {
+#ifdef MADV_SEQUENTIAL
+                    madvise(mapping, (size_t) info.st_size, MADV_SEQUENTIAL);
+#endif
+                    data = (char *) mapping;
+                    length = (int) info.st_size;
+                    mapped = true;
+                }
+            }
+            close(fd);
+        }
+        if (mapped) return;
+#endif
+        SDL_RWops *file = SDL_RWFromFile(path, "rb");
+        if (!file) return;
+        Sint64 size = SDL_RWsize(file);
+        if (size >= 0 && size < INT_MAX) {
+            data = MALLOC(char, (size_t) size + 1);
+            if (SDL_RWread(file, data, 1, (size_t) size) == (size_t) size) {
+                data[size] = '\0';
+                length = (int) size;
+            } else {
+                FREE(data);
+                data = 0;
+            }
+        }
+        SDL_RWclose(file);
+    }
+
+    MappedFile::~MappedFile() {
+#ifdef SPINE_SDL_MMAP
+        if (mapped) {
+            munmap(data, (size_t) length);
+            return;
+        }
+#endif
+        FREE(data);
+    }
+
+    spSkeletonData *readMappedSkeletonData(spSkeletonBinary *binary, const char *path) {
+        MappedFile file(path);
+        if (!file.getData()) return 0;
+        return spSkeletonBinary_readSkeletonData(binary, (const unsigned char *) file.getData(), file.getLength());
+    }
+
+    spSkeletonData *readMappedSkeletonData(spSkeletonJson *json, const char *path) {
+        MappedFile file(path);
+        if (!file.getData()) return 0;
+        return spSkeletonJson_readSkeletonData(json, file.getData());
+    }
+
+    spAtlas *createMappedAtlas(const char *path, void *rendererObject) {
+        MappedFile file(path);
+        if (!file.getData()) return 0;
+        // Page images are relative to the atlas, like in spAtlas_createFromFile()
+        const char *lastForwardSlash = strrchr(path, '/');
+        const char *lastBackwardSlash = strrchr(path, '\\');
+        const char *lastSlash = lastForwardSlash > lastBackwardSlash ? lastForwardSlash : lastBackwardSlash;
+        int dirLength = lastSlash ? (int) (lastSlash - path) : 0;
+        if (lastSlash == path) dirLength = 1; // Root path
+        char *dir = CALLOC(char, dirLength + 1);
+        memcpy(dir, path, dirLength);
+        spAtlas *atlas = spAtlas_create(file.getData(), file.getLength(), dir, rendererObject);
+        FREE(dir);
+        return atlas;
+    }
+
+    AtlasRepacker::AtlasRepacker(SDL_Renderer *renderer, int maxSize, int padding)
+    : renderer(renderer), maxSize(maxSize), padding(padding), pages(0), pagesCount(0), moved(0), movedCount(0) {
+    }
+
+    AtlasRepacker::~AtlasRepacker() {
+        // The shared textures aren't registered, so disposing the pages destroys them
+        for (int i = 0; i < pagesCount; ++i) spAtlasPage_dispose(pages[i]);
+        FREE(pages);
+        FREE(moved);
+    }
+
+    struct PackedRegion {
+        spAtlasRegion *region;
+        SDL_Rect source; // on the original page
+        int x, y;        // on the shared page
+        int page;
+    };
+
+    struct Shelf {
+        int page;
+        int y, height;
+        int x; // where the next region goes
+    };
+
+    // Tallest first, so every shelf is as tall as its first region
+    static int compareRegionHeights(const void *a, const void *b) {
+        const SDL_Rect &r1 = ((const PackedRegion *) a)->source, &r2 = ((const PackedRegion *) b)->source;
+        return r1.h != r2.h ? r2.h - r1.h : r2.w - r1.w;
+    }
+
+    int AtlasRepacker::repack(spAtlas **atlases, int count) {
+        if (!SDL_RenderTargetSupported(renderer) || count == 0) return 0;
+
+        int regionsCount = 0;
+        for (int i = 0; i < count; ++i)
+            for (spAtlasRegion *region = atlases[i]->regions; region; region = region->next) regionsCount++;
+        PackedRegion *regions = MALLOC(PackedRegion, regionsCount + 1);
+        regionsCount = 0;
+        for (int i = 0; i < count; ++i) {
+            for (spAtlasRegion *region = atlases[i]->regions; region; region = region->next) {
+                spAtlasPage *page = region->page;
+                if (!page->rendererObject) continue;
+                // The uvs cover the packed pixels whatever the rotation
+                PackedRegion &packed = regions[regionsCount];
+                packed.region = region;
+                packed.source.x = (int) SDL_lroundf(SDL_min(region->u, region->u2) * page->width);
+                packed.source.y = (int) SDL_lroundf(SDL_min(region->v, region->v2) * page->height);
+                packed.source.w = (int) SDL_lroundf(SDL_max(region->u, region->u2) * page->width) - packed.source.x;
+                packed.source.h = (int) SDL_lroundf(SDL_max(region->v, region->v2) * page->height) - packed.source.y;
+                packed.page = -1;
+                if (packed.source.w <= 0 || packed.source.h <= 0 || packed.source.w + padding > maxSize ||
+                    packed.source.h + padding > maxSize)
+                    continue;
+                regionsCount++;
+            }
+        }
+        if (regionsCount == 0) {
+            FREE(regions);
+            return 0;
+        }
+        SDL_qsort(regions, regionsCount, sizeof(PackedRegion), compareRegionHeights);
+
+        // Shelf packing, pma and straight alpha regions never share a page. There are never more shelves or pages
+        // than regions.
+        Shelf *shelves = MALLOC(Shelf, regionsCount);
+        int shelvesCount = 0;
+        int *widths = CALLOC(int, regionsCount);
+        int *heights = CALLOC(int, regionsCount);
+        spAtlasPage **sources = MALLOC(spAtlasPage *, regionsCount); // a page of each group, for its settings
+        int newPagesCount = 0;
+        for (int i = 0; i < regionsCount; ++i) {
+            PackedRegion &packed = regions[i];
+            int w = packed.source.w + padding, h = packed.source.h + padding;
+            int pma = packed.region->page->pma;
+            Shelf *shelf = 0;
+            for (int ii = 0; ii < shelvesCount && !shelf; ++ii) {
+                Shelf &candidate = shelves[ii];
+                if (sources[candidate.page]->pma == pma && candidate.height >= h && candidate.x + w <= maxSize) shelf = &candidate;
+            }
+            if (!shelf) {
+                int page = -1;
+                for (int ii = 0; ii < newPagesCount && page < 0; ++ii)
+                    if (sources[ii]->pma == pma && heights[ii] + h <= maxSize) page = ii;
+                if (page < 0) {
+                    page = newPagesCount++;
+                    sources[page] = packed.region->page;
+                }
+                shelf = &shelves[shelvesCount++];
+                shelf->page = page;
+                shelf->y = heights[page];
+                shelf->height = h;
+                shelf->x = 0;
+                heights[page] += h;
+            }
+            packed.page = shelf->page;
+            packed.x = shelf->x;
+            packed.y = shelf->y;
+            shelf->x += w;
+            widths[shelf->page] = SDL_max(widths[shelf->page], shelf->x);
+        }
+
+        // Copies the pixels as they are, straight or premultiplied
+        SDL_Texture *target = SDL_GetRenderTarget(renderer);
+        Uint8 r, g, b, a;
+        SDL_GetRenderDrawColor(renderer, &r, &g, &b, &a);
+        SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
+        int firstPage = pagesCount;
+        pages = REALLOC(pages, spAtlasPage *, pagesCount + newPagesCount);
+        for (int i = 0; i < newPagesCount; ++i) {
+            SDL_Texture *texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, widths[i], heights[i]);
+            if (!texture) break;
+            SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+            SDL_SetRenderTarget(renderer, texture);
+            SDL_RenderClear(renderer);
+            for (int ii = 0; ii < regionsCount; ++ii) {
+                PackedRegion &packed = regions[ii];
+                if (packed.page != i) continue;
+                SDL_Texture *source = (SDL_Texture *) packed.region->page->rendererObject;
+                SDL_Rect dest = {packed.x, packed.y, packed.source.w, packed.source.h};
+                SDL_SetTextureBlendMode(source, SDL_BLENDMODE_NONE);
+                SDL_RenderCopy(renderer, source, &packed.source, &dest);
+                SDL_SetTextureBlendMode(source, SDL_BLENDMODE_BLEND);
+            }
+            spAtlasPage *page = spAtlasPage_create(atlases[0], "repacked");
+            page->rendererObject = texture;
+            page->width = widths[i];
+            page->height = heights[i];
+            page->pma = sources[i]->pma;
+            page->minFilter = sources[i]->minFilter;
+            page->magFilter = sources[i]->magFilter;
+            pages[pagesCount++] = page;
+        }
+        SDL_SetRenderTarget(renderer, target);
+        SDL_SetRenderDrawColor(renderer, r, g, b, a);
+
+        // Same uvs relative to the pixels, which only moved
+        moved = REALLOC(moved, MovedRegion, movedCount + regionsCount);
+        for (int i = 0; i < regionsCount; ++i) {
+            PackedRegion &packed = regions[i];
+            if (firstPage + packed.page >= pagesCount) continue;
+            spAtlasRegion *region = packed.region;
+            spAtlasPage *from = region->page, *to = pages[firstPage + packed.page];
+            float scaleU = (float) from->width / to->width, scaleV = (float) from->height / to->height;
+            float offsetU = (float) (packed.x - packed.source.x) / to->width;
+            float offsetV = (float) (packed.y - packed.source.y) / to->height;
+            region->u = region->u * scaleU + offsetU;
+            region->u2 = region->u2 * scaleU + offsetU;
+            region->v = region->v * scaleV + offsetV;
+            region->v2 = region->v2 * scaleV + offsetV;
+            region->x += packed.x - packed.source.x;
+            region->y += packed.y - packed.source.y;
+            region->page = to;
+            moved[movedCount].region = region;
+            moved[movedCount].from = from;
+            movedCount++;
+        }
+        FREE(sources);
+        FREE(heights);
+        FREE(widths);
+        FREE(shelves);
+        FREE(regions);
+
+        // Pages no region uses anymore
+        for (int i = 0; i < count; ++i) {
+            for (spAtlasPage *page = atlases[i]->pages; page; page = page->next) {
+                bool used = false;
+                for (spAtlasRegion *region = atlases[i]->regions; region && !used; region = region->next) used = region->page == page;
+                if (used || !page->rendererObject) continue;
+                TextureRegistry::release((SDL_Texture *) page->rendererObject);
+                page->rendererObject = 0;
+            }
+        }
+        return pagesCount - firstPage;
+    }
+
+    int AtlasRepacker::countRemovedBatchBreaks(const spSkeleton *skeleton) const {
+        int before = 0, after = 0;
+        spAtlasPage *lastBefore = 0, *lastAfter = 0;
+        for (int i = 0; i < skeleton->slotsCount; ++i) {
+            spAttachment *attachment = skeleton->drawOrder[i]->attachment;
+            if (!attachment) continue;
+            spAtlasRegion *region;
+            if (attachment->type == SP_ATTACHMENT_REGION)
+                region = (spAtlasRegion *) ((spRegionAttachment *) attachment)->rendererObject;
+            else if (attachment->type == SP_ATTACHMENT_MESH)
+                region = (spAtlasRegion *) ((spMeshAttachment *) attachment)->rendererObject;
+            else
+                continue;
+
+            spAtlasPage *original = region->page;
+            for (int ii = 0; ii < movedCount; ++ii)
+                if (moved[ii].region == region) original = moved[ii].from;
+            if (original != lastBefore && lastBefore) before++;
+            if (region->page != lastAfter && lastAfter) after++;
+            lastBefore = original;
+            lastAfter = region->page;
+        }
+        return before - after;
+    }
+
+    SkeletonAsset::SkeletonAsset() : cache(0), skeletonPath(0), atlasPath(0), scale(1), atlas(0), skeletonData(0),
+                                     stateData(0), size(0), references(0), lastUsed(0) {
+    }
+
+    SkeletonAsset::~SkeletonAsset() {
+        if (stateData) spAnimationStateData_dispose(stateData);
+        if (skeletonData) spSkeletonData_dispose(skeletonData);
+        if (atlas) spAtlas_dispose(atlas);
+        FREE(skeletonPath);
+        FREE(atlasPath);
+    }
+
+    SkeletonDrawable *SkeletonAsset::createDrawable() {
+        SkeletonDrawable *drawable = new SkeletonDrawable(skeletonData, stateData);
+        drawable->asset = this;
+        retain();
+        return drawable;
+    }
+
+    void SkeletonAsset::release() {
+        references--;
+        if (references > 0) return;
+        // Eviction goes by when the last drawable let go, not by when the asset was acquired
+        lastUsed = ++cache->clock;
+        cache->trim();
+    }
+
+    void SkeletonAsset::computeSize() {
+        // Only what dominates: page pixels, mesh vertices and timeline frames
+        size = sizeof(SkeletonAsset);
+        for (spAtlasPage *page = atlas->pages; page; page = page->next) size += (size_t) page->width * page->height * 4;
+
+        for (int i = 0; i < skeletonData->skinsCount; ++i) {
+            for (spSkinEntry *entry = spSkin_getAttachments(skeletonData->skins[i]); entry; entry = entry->next) {
+                if (entry->attachment->type != SP_ATTACHMENT_MESH) continue;
+                spMeshAttachment *mesh = (spMeshAttachment *) entry->attachment;
+                int uvsCount = mesh->super.worldVerticesLength;
+                size += (mesh->super.verticesCount + uvsCount * 2) * sizeof(float);
+                size += mesh->trianglesCount * sizeof(unsigned short) + mesh->super.bonesCount * sizeof(int);
+            }
+        }
+
+        for (int i = 0; i < skeletonData->animationsCount; ++i) {
+            spTimelineArray *timelines = skeletonData->animations[i]->timelines;
+            for (int ii = 0; ii < timelines->size; ++ii) size += timelines->items[ii]->frames->size * sizeof(float);
+        }
+    }
+
+    AssetCache::AssetCache(size_t budget) : assets(0), assetsCount(0), assetsCapacity(0), budget(budget), size(0), clock(0) {
+    }
+
+    AssetCache::~AssetCache() {
+        for (int i = 0; i < assetsCount; ++i) delete assets[i];
+        FREE(assets);
+    }
+
+    SkeletonAsset *AssetCache::acquire(const char *skeletonPath, const char *atlasPath, float scale) {
+        clock++;
+        for (int i = 0; i < assetsCount; ++i) {
+            SkeletonAsset *asset = assets[i];
+            if (asset->scale == scale && strcmp(asset->skeletonPath, skeletonPath) == 0 && strcmp(asset->atlasPath, atlasPath) == 0) {
+                asset->lastUsed = clock;
+                asset->retain();
+                return asset;
+            }
+        }
+
+        spAtlas *atlas = createMappedAtlas(atlasPath, 0);
+        if (!atlas) return 0;
+        spSkeletonData *skeletonData;
+        size_t length = strlen(skeletonPath);
+        if (length > 5 && strcmp(skeletonPath + length - 5, ".json") == 0) {
+            spSkeletonJson *json = spSkeletonJson_create(atlas);
+            json->scale = scale;
+            skeletonData = readMappedSkeletonData(json, skeletonPath);
+            if (!skeletonData) printf("Error loading skeleton: %s\n", json->error ? json->error : skeletonPath);
+            spSkeletonJson_dispose(json);
+        } else {
+            spSkeletonBinary *binary = spSkeletonBinary_create(atlas);
+            binary->scale = scale;
+            skeletonData = readMappedSkeletonData(binary, skeletonPath);
+            if (!skeletonData) printf("Error loading skeleton: %s\n", binary->error ? binary->error : skeletonPath);
+            spSkeletonBinary_dispose(binary);
+        }
+        if (!skeletonData) {
+            spAtlas_dispose(atlas);
+            return 0;
+        }
+
+        SkeletonAsset *asset = new SkeletonAsset();
+        asset->cache = this;
+        MALLOC_STR(asset->skeletonPath, skeletonPath);
+        MALLOC_STR(asset->atlasPath, atlasPath);
+        asset->scale = scale;
+        asset->atlas = atlas;
+        asset->skeletonData = skeletonData;
+        asset->stateData = spAnimationStateData_create(skeletonData);
+        asset->computeSize();
+        asset->references = 1;
+        asset->lastUsed = clock;
+        if (assetsCount == assetsCapacity) {
+            assetsCapacity = assetsCapacity * 2 + 8;
+            assets = REALLOC(assets, SkeletonAsset *, assetsCapacity);
+        }
+        assets[assetsCount++] = asset;
+        size += asset->size;
+        // The new asset is referenced, so only older ones can make room for it
+        trim();
+        return asset;
+    }
+
+    void AssetCache::setBudget(size_t bytes) {
+        budget = bytes;
+        trim();
+    }
+
+    void AssetCache::trim() {
+        while (size > budget) {
+            int oldest = -1;
+            for (int i = 0; i < assetsCount; ++i) {
+                if (assets[i]->references > 0) continue;
+                if (oldest < 0 || assets[i]->lastUsed < assets[oldest]->lastUsed) oldest = i;
+            }
+            if (oldest < 0) return;
+            evict(oldest);
+        }
+    }
+
+    void AssetCache::purge() {
+        for (int i = assetsCount - 1; i >= 0; --i)
+            if (assets[i]->references == 0) evict(i);
+    }
+
+    void AssetCache::evict(int index) {
+        SkeletonAsset *asset = assets[index];
+        size -= asset->size;
+        assets[index] = assets[--assetsCount];
+        delete asset;
+    }
+
+    // Validates the header and page table and converts them to the host byte order. pages is allocated with MALLOC.
+    static const char *readBundleHeader(const char *data, int length, BundleHeader &header, BundlePage *&pages) {
+        pages = 0;
+        if (length < (int) sizeof(BundleHeader)) return "Not a bundle";
+        memcpy(&header, data, sizeof(BundleHeader));
+        if (memcmp(header.magic, "SPB1", 4) != 0) return "Not a bundle";
+        Uint32 *fields = &header.version;
+        for (int i = 0; i < 8; ++i) fields[i] = SDL_SwapLE32(fields[i]);
+        if (header.version != BUNDLE_VERSION) return "Unsupported bundle version";
+        if (!isAlphaFormat32(header.pixelFormat)) return "Unsupported bundle pixel format";
+
+        Uint64 size = (Uint64) length;
+        if ((Uint64) header.pageCount * sizeof(BundlePage) > size - sizeof(BundleHeader) ||
+            (Uint64) header.atlasOffset + header.atlasLength > size ||
+            (Uint64) header.skeletonOffset + header.skeletonLength + 1 > size ||
+            data[header.skeletonOffset + header.skeletonLength] != '\0')
+            return "Truncated bundle";
+
+        pages = MALLOC(BundlePage, header.pageCount + 1);
+        memcpy(pages, data + sizeof(BundleHeader), header.pageCount * sizeof(BundlePage));
+        for (Uint32 i = 0; i < header.pageCount; ++i) {
+            BundlePage &page = pages[i];
+            page.width = SDL_SwapLE32(page.width);
+            page.height = SDL_SwapLE32(page.height);
+            page.pitch = SDL_SwapLE32(page.pitch);
+            page.pixelsOffset = SDL_SwapLE32(page.pixelsOffset);
+            // Rows of 4-byte pixels, no larger than any renderer takes
+            if (page.width == 0 || page.height == 0 || page.width > 32768 || page.height > 32768 || page.pitch < page.width * 4)
+                return "Invalid bundle page";
+            if ((Uint64) page.pixelsOffset + (Uint64) page.pitch * page.height > size) return "Truncated bundle";
+        }
+        return 0;
+    }
+
+    SkeletonBundle::SkeletonBundle(const char *path, float scale) : atlas(0), skeletonData(0), error(0) {
+        MappedFile file(path);
+        if (!file.getData()) {
+            setError("Couldn't read the bundle");
+            return;
+        }
+        const char *data = file.getData();
+        BundleHeader header;
+        BundlePage *pages;
+        const char *message = readBundleHeader(data, file.getLength(), header, pages);
+        if (message) {
+            setError(message);
+            FREE(pages);
+            return;
+        }
+
+        // The pages come from the bundle, not from the files the atlas names
+        loadingBundle = true;
+        atlas = spAtlas_create(data + header.atlasOffset, (int) header.atlasLength, "", 0);
+        loadingBundle = false;
+        Uint32 pageCount = 0;
+        for (spAtlasPage *page = atlas ? atlas->pages : 0; page; page = page->next) pageCount++;
+        if (!atlas || pageCount != header.pageCount) {
+            setError("The bundle pages don't match its atlas");
+            FREE(pages);
+            return;
+        }
+        int i = 0;
+        for (spAtlasPage *page = atlas->pages; page; page = page->next, ++i) {
+            SDL_Texture *texture = SDL_CreateTexture(spSDL_getRenderer(), header.pixelFormat, SDL_TEXTUREACCESS_STATIC,
+                                                     (int) pages[i].width, (int) pages[i].height);
+            if (!texture) {
+                setError(SDL_GetError());
+                FREE(pages);
+                return;
+            }
+            SDL_UpdateTexture(texture, 0, data + pages[i].pixelsOffset, (int) pages[i].pitch);
+            page->rendererObject = texture;
+            page->width = (int) pages[i].width;
+            page->height = (int) pages[i].height;
+        }
+        FREE(pages);
+
+        if (header.skeletonIsJson) {
+            spSkeletonJson *json = spSkeletonJson_create(atlas);
+            json->scale = scale;
+            skeletonData = spSkeletonJson_readSkeletonData(json, data + header.skeletonOffset);
+            if (!skeletonData) setError(json->error);
+            spSkeletonJson_dispose(json);
+        } else {
+            spSkeletonBinary *binary = spSkeletonBinary_create(atlas);
+            binary->scale = scale;
+            skeletonData = spSkeletonBinary_readSkeletonData(binary, (const unsigned char *) data + header.skeletonOffset,
+                                                             (int) header.skeletonLength);
+            if (!skeletonData) setError(binary->error);
+            spSkeletonBinary_dispose(binary);
+        }
+    }
+
+    SkeletonBundle::~SkeletonBundle() {
+        if (skeletonData) spSkeletonData_dispose(skeletonData);
+        if (atlas) spAtlas_dispose(atlas);
+        FREE(error);
+    }
 
-        if (vertexEffect != 0) vertexEffect->end(vertexEffect);
+    void SkeletonBundle::setError(const char *message) {
+        FREE(error);
+        MALLOC_STR(error, message ? message : "Unknown error");
     }
 
 } /* namespace spine */
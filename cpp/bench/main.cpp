@@ -0,0 +1,266 @@
+/******************************************************************************
+ * Spine Runtimes License Agreement
+ * Last updated January 1, 2020. Replaces all prior versions.
+ *
+ * Copyright (c) 2013-2020, Esoteric Software LLC
+ *
+ * Integration of the Spine Runtimes into software or otherwise creating
+ * derivative works of the Spine Runtimes is permitted under the terms and
+ * conditions of Section 2 of the Spine Editor License Agreement:
+ * http://esotericsoftware.com/spine-editor-license
+ *
+ * Otherwise, it is permitted to integrate the Spine Runtimes into software
+ * or otherwise create derivative works of the Spine Runtimes (collectively,
+ * "Products"), provided that each user of the Products must obtain their own
+ * Spine Editor license and redistribution of the Products in any form must
+ * include this license and copyright notice.
+ *
+ * THE SPINE RUNTIMES ARE PROVIDED BY ESOTERIC SOFTWARE LLC "AS IS" AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL ESOTERIC SOFTWARE LLC BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES,
+ * BUSINESS INTERRUPTION, OR LOSS OF USE, DATA, OR PROFITS) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THE SPINE RUNTIMES, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+
+//
+// Headless benchmark: poses and draws N instances of every bundled skeleton for M frames on the software renderer
+// and reports the time spent in each phase, per frame.
+//
+// usage: bench [-n instances] [-m frames] [--json] [--trace file] [--verify] [asset...]
+//
+// Run it from the cpp folder so data/ is found. SDL_VIDEODRIVER defaults to dummy, so no window or GPU is needed.
+// Every run starts by checking each SIMD kernel against its scalar version with verifySimdKernels() and exits with 1
+// if one differs. --verify also builds the last frame with the scalar and the SIMD kernels, plain and with each
+// built-in vertex effect, and exits with 1 if any of them differ by a byte.
+//
+
+#include <spine/spine-sdl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+using namespace std;
+using namespace spine;
+
+struct BenchAsset {
+    const char *name;
+    float scale;
+    const char *skin;
+    const char *animations[2];
+};
+
+static const BenchAsset assets[] = {
+        {"spineboy", 0.6f, NULL, {"walk", NULL}},
+        {"raptor", 0.5f, NULL, {"walk", NULL}},
+        {"tank", 0.2f, NULL, {"drive", NULL}},
+        {"goblins", 1.4f, "goblingirl", {"walk", NULL}},
+        {"vine", 0.5f, NULL, {"grow", NULL}},
+        {"stretchyman", 0.6f, NULL, {"sneak", NULL}},
+        {"coin", 0.5f, NULL, {"animation", NULL}},
+        {"owl", 0.5f, NULL, {"idle", "blink"}},
+        {"mix-and-match", 0.5f, "full-skins/girl", {"dance", NULL}},
+};
+
+// Milliseconds per frame spent in each phase, plus the geometry of the last frame
+struct BenchResult {
+    double update, apply, world, build, submit, buildScalar;
+    int vertices, drawCalls;
+    bool identical; // SIMD and scalar builds, only checked with --verify
+};
+
+static const int width = 640, height = 480;
+
+static double toMs(Uint64 ticks, int frames) {
+    return (double) ticks * 1000.0 / (double) SDL_GetPerformanceFrequency() / frames;
+}
+
+// Builds the drawables with the scalar kernels and with the detected ones, plain (effect 0), with a SwirlEffect (1) or
+// with a JitterEffect (2), and compares the vertices and indices byte for byte
+static bool buildsMatch(vector<SkeletonDrawable *> &drawables, int effect) {
+    RenderCommandList lists[2];
+    for (int simd = 0; simd < 2; ++simd) {
+        setSimdEnabled(simd == 1);
+        // Fresh effects for each pass, so the jitter starts from the same seed
+        SwirlEffect swirl(150);
+        swirl.setAngle(60);
+        JitterEffect jitter(3, 3);
+        BatchVertexEffect *effects[] = {NULL, &swirl, &jitter};
+        for (size_t i = 0; i < drawables.size(); ++i) {
+            drawables[i]->batchVertexEffect = effects[effect];
+            drawables[i]->build(lists[simd]);
+            drawables[i]->batchVertexEffect = NULL;
+        }
+    }
+    setSimdEnabled(true);
+    RenderCommandList &scalar = lists[0], &simd = lists[1];
+    return scalar.vertexArray.size() == simd.vertexArray.size() && scalar.indexArray.size() == simd.indexArray.size() &&
+           memcmp(scalar.vertexArray.buffer(), simd.vertexArray.buffer(), scalar.vertexArray.size() * sizeof(SDL_Vertex)) == 0 &&
+           memcmp(scalar.indexArray.buffer(), simd.indexArray.buffer(), scalar.indexArray.size() * sizeof(int)) == 0;
+}
+
+static bool runAsset(SDL_Renderer *renderer, const BenchAsset &asset, int instances, int frames, bool verify, BenchResult &result) {
+    char path[256];
+    SDL_snprintf(path, sizeof(path), "data/%s-pma.atlas", asset.name);
+    SDLTextureLoader textureLoader(renderer);
+    Atlas atlas(path, &textureLoader);
+    SDL_snprintf(path, sizeof(path), "data/%s-pro.skel", asset.name);
+    SkeletonBinary binary(&atlas);
+    binary.setScale(asset.scale);
+    SkeletonData *skeletonData = binary.readSkeletonDataFile(path);
+    if (!skeletonData) {
+        printf("%s: %s\n", path, binary.getError().buffer());
+        return false;
+    }
+
+    AnimationStateData stateData(skeletonData);
+    vector<SkeletonDrawable *> drawables;
+    int columns = 1;
+    while (columns * columns < instances) columns++;
+    for (int i = 0; i < instances; ++i) {
+        SkeletonDrawable *drawable = new SkeletonDrawable(skeletonData, &stateData);
+        drawable->setUsePremultipliedAlpha(true);
+        Skeleton *skeleton = drawable->skeleton;
+        if (asset.skin) skeleton->setSkin(asset.skin);
+        skeleton->setSlotsToSetupPose();
+        skeleton->setPosition((i % columns + 0.5f) * width / columns, (i / columns + 1.0f) * height / columns);
+        // Spread the instances over the animation so they don't all show the same pose
+        for (int track = 0; track < 2 && asset.animations[track]; ++track)
+            drawable->state->setAnimation(track, asset.animations[track], true)->setTrackTime(i * 0.037f);
+        drawables.push_back(drawable);
+    }
+
+    // The same steps as SkeletonDrawable::update() and draw(), timed one by one
+    const float delta = 1.0f / 60;
+    Uint64 ticks[5] = {0, 0, 0, 0, 0};
+    RenderCommandList list;
+    for (int frame = 0; frame < frames; ++frame) {
+        Uint64 start = SDL_GetPerformanceCounter();
+        for (size_t i = 0; i < drawables.size(); ++i) {
+            drawables[i]->skeleton->update(delta);
+            drawables[i]->state->update(delta);
+        }
+        Uint64 applied = SDL_GetPerformanceCounter();
+        for (size_t i = 0; i < drawables.size(); ++i) drawables[i]->state->apply(*drawables[i]->skeleton);
+        Uint64 posed = SDL_GetPerformanceCounter();
+        for (size_t i = 0; i < drawables.size(); ++i) drawables[i]->skeleton->updateWorldTransform();
+        Uint64 transformed = SDL_GetPerformanceCounter();
+        list.clear();
+        for (size_t i = 0; i < drawables.size(); ++i) drawables[i]->build(list);
+        Uint64 built = SDL_GetPerformanceCounter();
+        SDL_RenderClear(renderer);
+        submit(renderer, list);
+        SDL_RenderPresent(renderer);
+        Uint64 end = SDL_GetPerformanceCounter();
+        ticks[0] += applied - start;
+        ticks[1] += posed - applied;
+        ticks[2] += transformed - posed;
+        ticks[3] += built - transformed;
+        ticks[4] += end - built;
+    }
+    result.update = toMs(ticks[0], frames);
+    result.apply = toMs(ticks[1], frames);
+    result.world = toMs(ticks[2], frames);
+    result.build = toMs(ticks[3], frames);
+    result.submit = toMs(ticks[4], frames);
+    result.vertices = (int) list.vertexArray.size();
+    result.drawCalls = (int) list.commands.size();
+
+    // The vertex kernels on their own: rebuild the last pose with the scalar fallback
+    setSimdEnabled(false);
+    Uint64 start = SDL_GetPerformanceCounter();
+    for (int frame = 0; frame < frames; ++frame) {
+        list.clear();
+        for (size_t i = 0; i < drawables.size(); ++i) drawables[i]->build(list);
+    }
+    result.buildScalar = toMs(SDL_GetPerformanceCounter() - start, frames);
+    setSimdEnabled(true);
+
+    result.identical = true;
+    for (int effect = 0; verify && effect < 3; ++effect) result.identical &= buildsMatch(drawables, effect);
+
+    for (size_t i = 0; i < drawables.size(); ++i) delete drawables[i];
+    delete skeletonData;
+    return true;
+}
+
+int main(int argc, char **argv) {
+    int instances = 100, frames = 300;
+    bool json = false, verify = false, mismatch = false;
+    const char *tracePath = NULL;
+    vector<const char *> names;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) instances = SDL_max(1, atoi(argv[++i]));
+        else if (strcmp(argv[i], "-m") == 0 && i + 1 < argc) frames = SDL_max(1, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--json") == 0) json = true;
+        else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) tracePath = argv[++i];
+        else if (strcmp(argv[i], "--verify") == 0) verify = true;
+        else if (argv[i][0] == '-') {
+            printf("usage: %s [-n instances] [-m frames] [--json] [--trace file] [--verify] [asset...]\n", argv[0]);
+            return 1;
+        } else
+            names.push_back(argv[i]);
+    }
+
+    // Every run first checks the SIMD kernels against the scalar ones on their edge cases, before timing anything
+    if (verifySimdKernels() != 0) {
+        fprintf(stderr, "the %s kernels differ from the scalar ones\n", getSimdName());
+        return 1;
+    }
+
+    if (!SDL_getenv("SDL_VIDEODRIVER")) SDL_setenv("SDL_VIDEODRIVER", "dummy", 1);
+    SDL_SetHint(SDL_HINT_RENDER_DRIVER, "software");
+    if (SDL_Init(SDL_INIT_VIDEO) != 0) {
+        printf("SDL_Init: %s\n", SDL_GetError());
+        return 1;
+    }
+    SDL_Window *window = SDL_CreateWindow("bench", 0, 0, width, height, SDL_WINDOW_HIDDEN);
+    SDL_Renderer *renderer = window ? SDL_CreateRenderer(window, -1, SDL_RENDERER_SOFTWARE) : NULL;
+    if (!renderer) {
+        printf("Couldn't create a software renderer: %s\n", SDL_GetError());
+        SDL_Quit();
+        return 1;
+    }
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+
+    if (json)
+        printf("{\"flavor\": \"cpp\", \"simd\": \"%s\", \"instances\": %d, \"frames\": %d, \"assets\": [", getSimdName(), instances, frames);
+    else
+        printf("cpp flavor, %s kernels, %d instances, %d frames, ms per frame\n"
+               "%-14s %8s %8s %8s %8s %8s %8s %9s %6s\n",
+               getSimdName(), instances, frames, "asset", "update", "apply", "world", "build", "submit", "scalar", "vertices", "draws");
+    bool first = true;
+    for (size_t i = 0; i < sizeof(assets) / sizeof(assets[0]); ++i) {
+        bool selected = names.empty();
+        for (size_t j = 0; j < names.size(); ++j) selected |= strcmp(names[j], assets[i].name) == 0;
+        BenchResult r;
+        if (!selected || !runAsset(renderer, assets[i], instances, frames, verify, r)) continue;
+        if (!r.identical) {
+            // stderr keeps the --json output valid
+            fprintf(stderr, "%s: the %s kernels built different vertices than the scalar ones\n", assets[i].name, getSimdName());
+            mismatch = true;
+        }
+        if (json)
+            printf("%s\n  {\"name\": \"%s\", \"update\": %.4f, \"apply\": %.4f, \"world\": %.4f, \"build\": %.4f, "
+                   "\"submit\": %.4f, \"buildScalar\": %.4f, \"vertices\": %d, \"drawCalls\": %d}",
+                   first ? "" : ",", assets[i].name, r.update, r.apply, r.world, r.build, r.submit, r.buildScalar, r.vertices,
+                   r.drawCalls);
+        else
+            printf("%-14s %8.3f %8.3f %8.3f %8.3f %8.3f %8.3f %9d %6d\n", assets[i].name, r.update, r.apply, r.world, r.build,
+                   r.submit, r.buildScalar, r.vertices, r.drawCalls);
+        first = false;
+        fflush(stdout);
+    }
+    if (json) printf("\n]}\n");
+    if (tracePath && !Trace::write(tracePath)) printf("Couldn't write %s, is spine-sdl built with SPINE_SDL_TRACE?\n", tracePath);
+
+    SDL_DestroyRenderer(renderer);
+    SDL_DestroyWindow(window);
+    SDL_Quit();
+    return mismatch ? 1 : 0;
+}
@@ -264,10 +264,9 @@ void raptor(SkeletonData *skeletonData, Atlas *atlas) {
     drawable.setUsePremultipliedAlpha(true);
 
     PowInterpolation pow2(2);
-    PowOutInterpolation powOut2(2);
-    SwirlVertexEffect effect(400, powOut2);
+    SwirlEffect effect(400);
     effect.setCenterY(-200);
-    drawable.vertexEffect = &effect;
+    drawable.batchVertexEffect = &effect;
 
     Skeleton *skeleton = drawable.skeleton;
     skeleton->setPosition(320, 590);
@@ -11,45 +11,953 @@
 
 namespace spine {
 
+    // A single SDL_RenderGeometry call: a run of vertices and indices sharing the same texture, blend mode and clip rect
+    struct RenderCommand {
+        SDL_Texture *texture;
+        SDL_BlendMode blendMode;
+        int firstVertex;
+        int vertexCount;
+        int firstIndex;
+        int indexCount;
+        bool clipped;       // drawn with clipRect as the renderer's clip rect
+        SDL_FRect clipRect; // in the coordinates of the vertices
+    };
+
+    // What building and drawing cost, counted as it goes: a few increments per attachment and a performance counter
+    // read per phase, cheap enough to leave on in release builds. Times are SDL_GetPerformanceCounter() ticks.
+    struct RenderStats {
+        int drawCalls;               // SDL_RenderGeometry and SDL_RenderGeometryRaw calls
+        int textureChanges;          // batch breaks caused by a different texture
+        int blendModeChanges;        // batch breaks caused by a different blend mode on the same texture
+        int clipRectChanges;         // batch breaks caused by entering or leaving a rectangular clipping attachment
+        int vertices;
+        int indices;
+        int trianglesBeforeClipping; // of the attachments under a clipping attachment
+        int trianglesAfterClipping;
+        int clipCacheHits;           // clipped attachments whose previous output was reused
+        int skippedSlots;            // transparent slots and attachments, inactive bones
+        Uint64 updateTicks;
+        Uint64 buildTicks;
+        Uint64 submitTicks;
+
+        RenderStats() { reset(); };
+
+        void reset();
+
+        // Sums the counters and times, e.g. to total the drawables of a frame
+        void add(const RenderStats &other);
+
+        static double toMilliseconds(Uint64 ticks);
+    };
+
+    // The geometry of one or more drawables: a single vertex/index stream plus the draw calls that replay it.
+    // Filling a list never calls SDL, so it can happen on any thread; submit() it on the thread that owns the renderer.
+    class RenderCommandList {
+    public:
+        Vector<SDL_Vertex> vertexArray;
+        Vector<int> indexArray;
+        Vector<RenderCommand> commands;
+
+        RenderCommandList();
+
+        void clear();
+
+        // Grows the streams by vertexCount vertices and indexCount indices drawn with the given state. The last command
+        // is extended if it has the same texture, blend mode and clip rect, otherwise a new one is started.
+        // Returns the offset the new indices must be rebased on.
+        int add(SDL_Texture *texture, SDL_BlendMode blendMode, int vertexCount, int indexCount, const SDL_FRect *clipRect = NULL);
+
+        // Drawables whose estimated bounds miss the viewport (in skeleton coordinates) are skipped by build().
+        // Pass NULL to disable culling, which is the default.
+        void setViewport(const SDL_FRect *viewport);
+
+        const SDL_FRect *getViewport() const { return hasViewport ? &viewport : NULL; };
+
+        // Number of drawables skipped since the last clear()
+        int culledCount;
+
+        // What was added since the last clear(): vertices, indices and batch breaks, plus the clipping, skipped
+        // slots and build time of the drawables built into it. A SkeletonBatch adds the submit and keeps them
+        // after end(), until the next begin().
+        RenderStats stats;
+
+    private:
+        SDL_FRect viewport;
+        bool hasViewport;
+    };
+
+    // Replays the draw calls of a list, in order. Clipped commands are drawn within the application's clip rect, which
+    // is restored afterwards. The calls and the time they took are added to stats, if given.
+    void submit(SDL_Renderer *renderer, const RenderCommandList &list, RenderStats *stats = NULL);
+
+    // Name of the vertex kernels build() uses: "avx2", "sse2", "neon" or "scalar", picked from the CPU features
+    const char *getSimdName();
+
+    // Pass false to force the scalar kernels, e.g. to compare results or timings. Not while building on other threads.
+    void setSimdEnabled(bool enabled);
+
+    // Runs each detected kernel and its scalar version on the same edge cases: every count up to 19, so each lane
+    // width leaves tails of 1 to 3, and color bytes at 0, 1, 254 and 255. Logs the kernels that differ and returns
+    // how many do, 0 when the SIMD kernels are bit-identical to the scalar ones.
+    int verifySimdKernels();
+
+    // Collects the geometry of many drawables into one RenderCommandList and submits it at end().
+    // Adjacent runs with the same texture and blend mode are merged, even across drawables, so a crowd
+    // sharing an atlas page costs a single draw call. Paint order is the order of the draw calls.
+    class SkeletonBatch : public RenderCommandList {
+    public:
+        SkeletonBatch();
+
+        void begin(SDL_Renderer *renderer);
+
+        void end();
+
+    private:
+        SDL_Renderer *renderer;
+    };
+
+    // A fixed-size pool of SDL threads. run() splits [0, count) evenly over the workers and the calling thread.
+    // Each participant takes jobs from the front of its own range and, once that runs dry, steals the back half
+    // of someone else's range, so uneven jobs still keep every core busy. run() returns when all jobs are done
+    // and must not be called from more than one thread at a time.
+    class WorkerPool {
+    public:
+        typedef void (*Job)(void *context, int index);
+
+        // threadCount <= 0 starts one worker per additional CPU core
+        explicit WorkerPool(int threadCount = 0);
+
+        ~WorkerPool();
+
+        void run(Job job, void *context, int count);
+
+        int getThreadCount() const { return threadCount; };
+
+    private:
+        struct Queue {
+            SDL_SpinLock lock;
+            int begin;
+            int end;
+            char padding[64 - sizeof(SDL_SpinLock) - 2 * sizeof(int)]; // a cache line each, see queueMemory
+        };
+
+        WorkerPool(const WorkerPool &);
+        WorkerPool &operator=(const WorkerPool &);
+
+        static int workerMain(void *data);
+
+        void work(int self);
+
+        bool pop(int self, int &index);
+
+        bool steal(int self, int &index);
+
+        int threadCount;
+        SDL_Thread **threads;
+        Queue *queues;
+        char *queueMemory; // holds the queues from its first 64-byte boundary, so none shares a cache line
+        SDL_sem *wake;
+        SDL_sem *done;
+        SDL_atomic_t pending;
+        SDL_atomic_t nextIndex;
+        SDL_atomic_t quit;
+        Job job;
+        void *context;
+    };
+
+    // Chrome Trace Event output of the update and draw pipeline, for chrome://tracing or ui.perfetto.dev. Markers are
+    // only recorded when spine-sdl.cpp is compiled with SPINE_SDL_TRACE, otherwise they compile to nothing.
+    class Trace {
+    public:
+        static bool isEnabled();
+
+        // Every thread records into its own ring buffer without locking, so write while no traced code runs, e.g.
+        // between frames. Returns false if tracing is compiled out or the file can't be written.
+        static bool write(const char *path);
+    };
+
+    class SkeletonDrawable;
+
+    class SkeletonAsset;
+
+    // Shares poses between drawables of the same SkeletonData playing the same animations at (nearly) the same time.
+    // The first drawable to reach a pose in a frame computes the world transform and the geometry in its update(), every
+    // other one copies that geometry to its own position. Drawables opt in with SkeletonDrawable::setPoseCache().
+    class PoseCache {
+    public:
+        // Animation times are rounded to 1 / fps, drawables closer than that in time show the same pose
+        explicit PoseCache(float fps = 30);
+
+        ~PoseCache();
+
+        // Forgets the poses of the previous frame. Call it once per frame, before updating the drawables.
+        void clear();
+
+        // Distinct poses since the last clear()
+        int getPoseCount() const { return used; };
+
+        // Drawables that reused a pose computed by another one since the last clear()
+        int getSharedCount() const { return shared; };
+
+    private:
+        friend class SkeletonDrawable;
+
+        static const int maxTracks = 4;
+
+        struct Key {
+            SkeletonData *data;
+            Skin *skin;
+            float scaleX, scaleY;
+            Uint32 color;
+            bool premultipliedAlpha, cullAttachments;
+            int trackCount;
+            int trackIndices[maxTracks];
+            int frames[maxTracks];
+            Animation *animations[maxTracks];
+        };
+
+        struct Entry : public SpineObject {
+            Key key;
+            Uint32 hash;
+            const SkeletonDrawable *owner;
+            SDL_SpinLock lock; // held by the owner until the geometry is built
+            RenderCommandList geometry; // relative to the skeleton position
+            float bounds[4];
+        };
+
+        // Returns the entry for the key, creating it with the drawable as its owner if this is the first time it's seen.
+        // A new entry is returned locked, the owner unlocks it once it has built the geometry.
+        Entry *acquire(const Key &key, const SkeletonDrawable *drawable, bool &created);
+
+        void rehash(int size);
+
+        float fps;
+        int generation;
+        SDL_SpinLock lock;
+        Vector<Entry *> entries;
+        int used;
+        int shared;
+        Vector<int> table; // open addressing, entry index + 1 or 0 if the slot is free
+    };
+
+    // Clips attachments to the clipping attachment they're under, in place of SkeletonClipping. The clipping polygon is
+    // split into convex parts only when it moves. The vertex kernels find the triangles entirely inside a part, which
+    // are kept whole, and the ones whose bounds miss it, which are dropped; only the rest are clipped
+    // (Sutherland-Hodgman) into buffers that are reused. The output of each slot is kept and returned again while
+    // neither the slot's vertices nor the clipping polygon move.
+    class SlotClipper {
+    public:
+        SlotClipper();
+
+        ~SlotClipper();
+
+        void clipStart(Slot &slot, ClippingAttachment *clip);
+
+        void clipEnd(Slot &slot);
+
+        void clipEnd();
+
+        bool isClipping() const { return clip != NULL; };
+
+        // A clip range left to the renderer's clip rect: it ends like a clipped one, but nothing is clipped
+        void scissorStart(ClippingAttachment *clip) { scissor = clip; };
+
+        bool isScissoring() const { return scissor != NULL; };
+
+        // Clips count vertices (x, y pairs, with as many uvs) and their triangles. Returns true if the slot's previous
+        // output was still valid and is returned as is. Pass cache false to modify the output.
+        bool clipTriangles(Slot &slot, const float *vertices, int count, const unsigned short *triangles, int trianglesCount,
+                           const float *uvs, bool cache = true);
+
+        Vector<float> &getClippedVertices() { return output->vertices; };
+
+        Vector<float> &getClippedUVs() { return output->uvs; };
+
+        Vector<unsigned short> &getClippedTriangles() { return output->triangles; };
+
+    private:
+        struct Output : public SpineObject {
+            Output() : key(0), valid(false) {};
+
+            Uint64 key;
+            bool valid;
+            Vector<float> vertices;
+            Vector<float> uvs;
+            Vector<unsigned short> triangles;
+        };
+
+        void buildParts();
+
+        void clipTriangle(const float *edges, int edgeCount, const float *vertices, const float *uvs, const int *indices);
+
+        void addVertex(const float *vertex);
+
+        ClippingAttachment *clip;
+        ClippingAttachment *scissor;
+        Vector<float> polygon;
+        Uint64 polygonHash;
+        Triangulator triangulator;
+        Vector<int> parts;     // first edge and edge count of each convex part, its bounds first
+        Vector<float> edges;   // a, b, c with a * x + b * y + c >= 0 on the inner side
+        Vector<float> scratch; // two polygons of x, y, u, v, for Sutherland-Hodgman
+        int scratchSize;
+        Vector<Uint8> codes;
+        Vector<int> remap;
+        Vector<Output *> outputs; // by slot index
+        Output uncached;
+        Output *output;
+    };
+
+    // A vertex effect that transforms a whole attachment per call, where VertexEffect takes a virtual call per vertex.
+    // Set one as SkeletonDrawable::batchVertexEffect.
+    class BatchVertexEffect {
+    public:
+        virtual ~BatchVertexEffect() {};
+
+        virtual void begin(Skeleton &skeleton) = 0;
+
+        // Transforms count vertices in place: world positions and uvs are x, y pairs, colors start as the attachment's
+        // tint. uvs and colors are NULL for effects that only move vertices.
+        virtual void transform(float *positions, float *uvs, SDL_Color *colors, int count) = 0;
+
+        virtual void end() = 0;
+
+        // Effects that only move vertices keep the vertices packed as fast as without an effect
+        virtual bool movesOnly() const { return false; };
+    };
+
+    // SwirlVertexEffect with a PowOut (or, with powOut false, Pow) interpolation, 4 vertices at a time. The center
+    // is relative to the skeleton position and the angle is in degrees.
+    class SwirlEffect : public BatchVertexEffect {
+    public:
+        explicit SwirlEffect(float radius, int power = 2, bool powOut = true);
+
+        void begin(Skeleton &skeleton);
+
+        void transform(float *positions, float *uvs, SDL_Color *colors, int count);
+
+        void end() {};
+
+        bool movesOnly() const { return true; };
+
+        void setCenterX(float centerX) { this->centerX = centerX; };
+
+        void setCenterY(float centerY) { this->centerY = centerY; };
+
+        void setRadius(float radius) { this->radius = radius; };
+
+        void setAngle(float degrees) { angle = degrees; };
+
+        float getCenterX() const { return centerX; };
+
+        float getCenterY() const { return centerY; };
+
+        float getRadius() const { return radius; };
+
+        float getAngle() const { return angle; };
+
+    private:
+        float centerX, centerY, radius, angle;
+        int power;
+        bool powOut;
+        float worldX, worldY;
+    };
+
+    // JitterVertexEffect, offsetting each vertex by up to jitterX and jitterY either way (triangularly distributed)
+    // from its own generator, 2 vertices at a time. Don't share one between drawables built on different threads.
+    class JitterEffect : public BatchVertexEffect {
+    public:
+        JitterEffect(float jitterX, float jitterY, Uint32 seed = 1);
+
+        void begin(Skeleton &) {}
+
+        void transform(float *positions, float *uvs, SDL_Color *colors, int count);
+
+        void end() {};
+
+        bool movesOnly() const { return true; };
+
+        void setJitterX(float jitterX) { amounts[0] = jitterX; };
+
+        void setJitterY(float jitterY) { amounts[1] = jitterY; };
+
+        float getJitterX() const { return amounts[0]; };
+
+        float getJitterY() const { return amounts[1]; };
+
+    private:
+        float amounts[2];
+        Uint32 state[4];
+    };
+
+    // Runs a VertexEffect as a BatchVertexEffect, one call per vertex with the colors converted to floats and back
+    class VertexEffectAdapter : public BatchVertexEffect {
+    public:
+        explicit VertexEffectAdapter(VertexEffect *effect = NULL) : effect(effect) {};
+
+        void begin(Skeleton &skeleton) { effect->begin(skeleton); };
+
+        void transform(float *positions, float *uvs, SDL_Color *colors, int count);
+
+        void end() { effect->end(); };
+
+        void setEffect(VertexEffect *effect) { this->effect = effect; };
+
+        VertexEffect *getEffect() const { return effect; };
+
+    private:
+        VertexEffect *effect;
+    };
+
     class SkeletonDrawable {
     public:
         Skeleton *skeleton;
         AnimationState *state;
         float timeScale;
-        mutable Vector<SDL_Vertex> vertexArray;
         VertexEffect *vertexEffect;
+        BatchVertexEffect *batchVertexEffect; // used in place of vertexEffect when set
 
         SkeletonDrawable(SkeletonData *skeleton, AnimationStateData *stateData = 0);
 
-        ~SkeletonDrawable();
+        virtual ~SkeletonDrawable();
 
         void update(float deltaTime);
 
+        // Updates every drawable on the pool and returns once all of them are posed. Drawables may share an
+        // AnimationStateData (it is only read), but the same skeleton or state must not appear twice, otherwise
+        // everything is updated on the calling thread. Listeners are called from the worker threads and the
+        // SpineExtension must be thread-safe (DefaultSpineExtension is, DebugExtension isn't).
+        static void updateAll(WorkerPool &pool, SkeletonDrawable *const *drawables, int count, float deltaTime);
+
         virtual void draw(SDL_Renderer* renderer) const;
 
-        void setUsePremultipliedAlpha(bool usePMA) { usePremultipliedAlpha = usePMA; };
+        virtual void draw(SkeletonBatch &batch) const;
+
+        // Appends the geometry of the current pose to the list without calling SDL. Different drawables can be built
+        // on different threads at the same time, as long as they don't share the list or a vertex effect.
+        virtual void build(RenderCommandList &list) const;
+
+        void setUsePremultipliedAlpha(bool usePMA) {
+            usePremultipliedAlpha = usePMA;
+            markDirty();
+        };
 
         bool getUsePremultipliedAlpha() const { return usePremultipliedAlpha; };
 
+        // draw(SDL_Renderer*) hands the world vertices, the attachment uvs and indices straight to SDL_RenderGeometryRaw
+        // instead of packing them into SDL_Vertex first. That's one draw call per attachment, so it pays off for
+        // skeletons with few, large meshes. Ignored while a vertex effect or a pose cache is set.
+        void setUseGeometryRaw(bool raw) { useGeometryRaw = raw; };
+
+        bool getUseGeometryRaw() const { return useGeometryRaw; };
+
+        // Keeps the geometry of the last build and replays it for as long as the skeleton doesn't change. A skeleton
+        // that isn't updated costs a counter check; after an update the bones, slots, attachments and draw order are
+        // hashed, and a paused or held pose costs that hash instead of a rebuild. Ignored while a vertex effect is set.
+        void setUseGeometryCache(bool cache) { useGeometryCache = cache; };
+
+        bool getUseGeometryCache() const { return useGeometryCache; };
+
+        // Bumped by every update() that poses the skeleton and by the setters that change the geometry. Changes
+        // followed by an update() are found by the pose hash; call markDirty() after changing the skeleton without
+        // updating it, or something the pose hash doesn't see like the texture of an atlas page: it forces the
+        // geometry cache to rebuild.
+        void markDirty() {
+            ++generation;
+            ++dirtyGeneration;
+        };
+
+        unsigned getGeneration() const { return generation; };
+
+        // Skips region and mesh attachments entirely outside the viewport of the list being built, before their
+        // vertices are clipped or packed. Worth it for large rigs that are often only partly visible.
+        void setUseAttachmentCulling(bool cull) { cullAttachments = cull; };
+
+        bool getUseAttachmentCulling() const { return cullAttachments; };
+
+        // World-space bounds of the vertices generated by the last build() into a list with a viewport
+        const SDL_FRect &getBounds() const { return bounds; };
+
+        // True if the last build() skipped the skeleton because it was outside the viewport
+        bool wasCulled() const { return culled; };
+
+        // Level of detail: poses the skeleton on every interval-th call to update() only (1, 2, 4 or 8) and passes it
+        // all the time accumulated since the previous pose, so animation time stays exact and no event is lost. Events
+        // and listeners fire on the update that poses the skeleton.
+        void setUpdateInterval(int interval);
+
+        int getUpdateInterval() const { return updateInterval; };
+
+        // Between poses, blends the local bone transforms from the previous pose to the latest one instead of holding
+        // the latest one. Smoother, but it costs an updateWorldTransform() per update and lags one interval behind.
+        // Attachments, colors and draw order still change on the updates that pose the skeleton.
+        void setInterpolateBones(bool interpolate) { interpolateBones = interpolate; };
+
+        bool getInterpolateBones() const { return interpolateBones; };
+
+        // A simple LOD policy using the last build() into a list with a viewport: 8 if the skeleton was culled, 1 if
+        // its bounds are at least fullRateSize pixels across and half the rate every time the size halves after that.
+        int suggestUpdateInterval(float fullRateSize) const;
+
+        // Shares the world transform and geometry with other drawables using the same cache whenever they play the
+        // same animations at the same time, with the same skin, scale, color, premultiplied alpha and attachment
+        // culling and no mixing. AnimationState::apply() still runs for every drawable, so events are exact, but the
+        // bones of a drawable that reused a pose have stale world transforms until it is drawn. Only the skin is
+        // compared, not the attachments: a drawable whose slots were changed by hand draws the attachments of
+        // whoever computed the pose, so don't give those a cache. Pass NULL to stop sharing.
+        void setPoseCache(PoseCache *cache) { poseCache = cache; };
+
+        PoseCache *getPoseCache() const { return poseCache; };
+
+        // What the last update() and the last build() or draw() cost. Draw calls and submit time are only counted
+        // by draw(SDL_Renderer*); in a batch they go to the batch. Clipping and skipped slots are counted when the
+        // geometry is generated, not when a geometry cache or a shared pose replays it.
+        const RenderStats &getStats() const { return stats; };
+
     private:
+        friend class SkeletonAsset;
+
+        void advance(float deltaTime);
+
+        void buildGeometry(RenderCommandList &list) const;
+
+        bool isOutside(const SDL_FRect &viewport) const;
+
+        bool makePoseKey(PoseCache::Key &key) const;
+
+        void buildSkeleton(RenderCommandList &list) const;
+
+        void buildPose();
+
+        void buildFromPose(RenderCommandList &list) const;
+
+        void drawRaw(SDL_Renderer *renderer) const;
+
+        bool hasSharedPose() const { return pose && poseCache && poseGeneration == poseCache->generation; };
+
+        bool hasVertexEffect() const { return vertexEffect != NULL || batchVertexEffect != NULL; };
+
+        BatchVertexEffect *getVertexEffect() const;
+
+        bool refreshGeometryCache(RenderStats &work) const;
+
+        Uint64 getPoseSignature() const;
+
+        void storeBones(Vector<float> &pose);
+
+        void blendBones(float alpha);
+
+        void updateBounds(const SDL_Vertex *vertices, int count, const float *culledBounds) const;
+
         mutable bool ownsAnimationStateData;
         mutable Vector<float> worldVertices;
         mutable Vector<float> tempUvs;
-        mutable Vector<Color> tempColors;
+        mutable Vector<SDL_Color> tempColors;
+        mutable VertexEffectAdapter effectAdapter;
         mutable Vector<unsigned short> quadIndices;
-        mutable SkeletonClipping clipper;
+        mutable SlotClipper clipper;
         mutable bool usePremultipliedAlpha;
+        mutable SkeletonBatch localBatch;
+        mutable SDL_FRect bounds;
+        mutable float boundsPadding[4]; // how far the vertices reached past the bones: left, top, right, bottom
+        mutable bool hasBounds;
+        mutable bool culled;
+        bool cullAttachments;
+        int updateInterval;
+        int updateFrame;
+        float pendingDelta;
+        bool posed;
+        bool interpolateBones;
+        Vector<float> bonesFrom, bonesTo; // local transforms of the previous and latest pose, 7 floats per bone
+        PoseCache *poseCache;
+        PoseCache::Entry *pose;
+        int poseGeneration;
+        mutable bool worldStale;
+        bool useGeometryRaw;
+        mutable Vector<SDL_Color> rawColors;
+        bool useGeometryCache;
+        unsigned generation;
+        unsigned dirtyGeneration; // the part of generation that came from markDirty()
+        mutable unsigned cachedGeneration;
+        mutable unsigned cachedDirtyGeneration;
+        mutable Uint64 cachedSignature;
+        mutable int cachedUploads; // pagesUploaded when the cache was built
+        mutable bool cacheValid;
+        mutable RenderCommandList cachedGeometry;
+        SkeletonAsset *asset; // released when the drawable is deleted
+        mutable RenderStats stats;
+    };
+
+    // A vertex of a BakedAnimation: the position in 16-bit fixed point (scaled per frame), the texture coordinates
+    // normalized to 16 bits. 12 bytes instead of the 20 of an SDL_Vertex.
+    struct BakedVertex {
+        Sint16 x, y;
+        Uint16 u, v;
+        SDL_Color color;
+    };
+
+    struct BakedFrame {
+        int firstCommand;
+        int commandCount;
+        float scale;     // position units per fixed point step
+        float bounds[4]; // min x, min y, max x, max y relative to the skeleton origin
     };
 
+    // One animation of a skeleton sampled into ready-to-draw geometry, for crowds that only ever loop one animation.
+    // Playing a frame back is a copy into the list, with no bone or attachment math at all.
+    class BakedAnimation {
+    public:
+        // Poses a skeleton in the given skin at fps frames per second over the animation duration and stores what
+        // build() would have generated. The atlas textures must stay alive as long as the baked animation.
+        // Events, vertex effects and the skeleton color are not baked.
+        BakedAnimation(SkeletonData *skeletonData, const String &animationName, float fps = 30, const String &skinName = "",
+                       bool usePremultipliedAlpha = false);
+
+        int getFrameCount() const { return (int) frames.size(); };
+
+        float getFps() const { return fps; };
+
+        float getDuration() const { return duration; };
+
+        // Appends a frame (wrapped around) with the skeleton origin at x, y. Frames whose bounds miss the viewport
+        // of the list are skipped and counted as culled.
+        void build(RenderCommandList &list, int frame, float x, float y) const;
+
+    private:
+        float fps;
+        float duration;
+        mutable Vector<BakedFrame> frames;
+        mutable Vector<RenderCommand> commands;
+        mutable Vector<BakedVertex> vertices;
+        mutable Vector<Uint16> indices; // relative to the first vertex of their command
+    };
+
+    // Plays a BakedAnimation back in a loop. Any number of drawables can share the same animation.
+    class BakedDrawable {
+    public:
+        BakedAnimation *animation;
+        float x, y;
+        float time;
+        float timeScale;
+
+        explicit BakedDrawable(BakedAnimation *animation);
+
+        void update(float deltaTime);
+
+        int getFrame() const;
+
+        void draw(SkeletonBatch &batch) const { build(batch); };
+
+        void build(RenderCommandList &list) const { animation->build(list, getFrame(), x, y); };
+    };
+
+    // Ways to create atlas page textures, combined as flags. Without any, SDL_CreateTextureFromSurface() picks the format.
+    enum TextureOptions {
+        // Converts the image once to the renderer's preferred 32-bit format and uploads it to a STATIC texture
+        TextureOptions_NativeFormat = 1,
+        // Premultiplies the alpha of pages not exported with pma, so setUsePremultipliedAlpha(true) suits every
+        // skeleton. Pages get pma set.
+        TextureOptions_PremultiplyAlpha = 2
+    };
+
+    // Textures shared by every atlas that loads the same image on the same renderer, so a page referenced by several
+    // atlases is decoded and uploaded once. Paths are compared after resolving them to absolute ones. Release every
+    // texture before destroying its renderer.
+    class TextureRegistry {
+    public:
+        // Returns the texture with one more reference, loading the image on the first request. NULL if it can't be
+        // loaded. Textures loaded with different options are never shared.
+        static SDL_Texture *acquire(SDL_Renderer *renderer, const char *path, Uint32 options = 0);
+
+        // Like acquire() but NULL instead of loading the image if it isn't registered yet
+        static SDL_Texture *find(SDL_Renderer *renderer, const char *path, Uint32 options = 0);
+
+        // Registers a texture created from an image decoded elsewhere, or adds a reference to the one already there
+        static SDL_Texture *add(SDL_Renderer *renderer, const char *path, Uint32 options, SDL_Surface *surface);
+
+        // Drops a reference and destroys the texture with the last one. Textures that aren't registered are
+        // destroyed right away.
+        static void release(SDL_Texture *texture);
+
+        static int getReferenceCount(SDL_Texture *texture);
+
+        static int getTextureCount();
+    };
+
+    // Decodes atlas pages on background threads and creates their textures on the renderer thread in pump(). Until then
+    // a page has no texture and drawables skip the slots that use it. Don't delete an atlas with pages in flight,
+    // finish() first.
+    class AsyncTextureLoader : public TextureLoader {
+    public:
+        explicit AsyncTextureLoader(SDL_Renderer *renderer, int threadCount = 2, Uint32 options = 0);
+
+        // Drops the pages that haven't been uploaded yet, they stay without a texture
+        virtual ~AsyncTextureLoader();
+
+        virtual void load(AtlasPage &page, const String &path);
+
+        virtual void unload(void *texture);
+
+        // Creates textures for the decoded pages until budgetMs milliseconds have passed, at least one per call.
+        // Call it on the renderer thread, e.g. once per frame. Returns how many pages are still pending.
+        int pump(Uint32 budgetMs);
+
+        // Blocks until every page is uploaded
+        void finish();
+
+        int getPendingCount() const;
+
+        // True once the page has a texture
+        static bool isPageReady(AtlasPage &page) { return page.getRendererObject() != NULL; };
+
+    private:
+        struct Job : public SpineObject {
+            AtlasPage *page;
+            String path;
+            SDL_Surface *surface;
+            Job *next;
+        };
+
+        AsyncTextureLoader(const AsyncTextureLoader &);
+        AsyncTextureLoader &operator=(const AsyncTextureLoader &);
+
+        static int decodeMain(void *data);
+
+        void upload(Job *job);
+
+        SDL_Renderer *renderer;
+        Uint32 options;
+        int threadCount;
+        SDL_Thread **threads;
+        SDL_mutex *mutex;
+        SDL_cond *queuedCond;  // signaled when a page is queued or the loader shuts down
+        SDL_cond *decodedCond; // signaled when a page is decoded
+        Job *queuedHead, *queuedTail;
+        Job *decodedHead, *decodedTail;
+        int pending;
+        bool quit;
+    };
+
+    // A whole file as a read-only, NUL-terminated buffer. It is mapped into memory when possible, instead of being
+    // copied, and released with the MappedFile.
+    class MappedFile : public SpineObject {
+    public:
+        explicit MappedFile(const String &path);
+
+        ~MappedFile();
+
+        // NULL if the file couldn't be read
+        const char *getData() const { return data; };
+
+        int getLength() const { return length; };
+
+        // False when the file was copied instead, e.g. without mmap or when it fills its last page
+        bool isMapped() const { return mapped; };
+
+    private:
+        MappedFile(const MappedFile &);
+        MappedFile &operator=(const MappedFile &);
+
+        char *data;
+        int length;
+        bool mapped;
+    };
+
+    // Parse straight from the mapped file, which is released before they return. NULL if the file can't be read or
+    // parsed.
+    SkeletonData *readMappedSkeletonData(SkeletonBinary &binary, const String &path);
+
+    SkeletonData *readMappedSkeletonData(SkeletonJson &json, const String &path);
+
+    Atlas *createMappedAtlas(const String &path, TextureLoader *textureLoader);
+
+    // A .spb bundle is a BundleHeader, pageCount BundlePages and the sections they point at: the .atlas text, the
+    // raw pixels of each page in pixelFormat and the skeleton (.skel or .json, followed by a NUL). Every field is
+    // little-endian and offsets are from the start of the file. tools/bundle.cpp converts existing files.
+    struct BundleHeader {
+        char magic[4]; // "SPB1"
+        Uint32 version;
+        Uint32 pixelFormat; // an SDL_PixelFormatEnum
+        Uint32 pageCount;
+        Uint32 atlasOffset, atlasLength;
+        Uint32 skeletonOffset, skeletonLength;
+        Uint32 skeletonIsJson;
+    };
+
+    struct BundlePage {
+        Uint32 width, height;
+        Uint32 pitch; // bytes from one row to the next
+        Uint32 pixelsOffset;
+    };
+
+    static const Uint32 BUNDLE_VERSION = 1;
+
     class SDLTextureLoader : public TextureLoader {
     public:
         virtual void load(AtlasPage &page, const String &path);
 
         virtual void unload(void *texture);
 
-        SDLTextureLoader(SDL_Renderer* sdl_renderer) : renderer(sdl_renderer) {}
+        // options are TextureOptions flags
+        SDLTextureLoader(SDL_Renderer* sdl_renderer, Uint32 options = 0) : renderer(sdl_renderer), options(options) {}
     private:
         SDL_Renderer* renderer;
+        Uint32 options;
+    };
+
+    // A skeleton and its atlas loaded from a bundle. The file is mapped and the page pixels go straight into STATIC
+    // textures: no PNG decoding, no pixel conversion (SDL converts them if the renderer can't use the bundle format).
+    class SkeletonBundle : public SpineObject {
+    public:
+        SkeletonBundle(SDL_Renderer *renderer, const String &path, float scale = 1);
+
+        ~SkeletonBundle();
+
+        // NULL if the bundle couldn't be loaded, see getError()
+        SkeletonData *getSkeletonData() { return skeletonData; };
+
+        Atlas *getAtlas() { return atlas; };
+
+        const String &getError() const { return error; };
+
+    private:
+        SkeletonBundle(const SkeletonBundle &);
+
+        SkeletonBundle &operator=(const SkeletonBundle &);
+
+        SDLTextureLoader textureLoader; // destroys the page textures with the atlas
+        Atlas *atlas;
+        SkeletonData *skeletonData;
+        String error;
+    };
+
+    // Copies the regions of one or more atlases into as few shared pages as fit, so skeletons whose attachments span
+    // several pages switch textures, and break their batches, less often. The region uvs and pages are rewritten, so
+    // repack before loading skeleton data from the atlases: attachments take their uvs from the regions when loaded.
+    // The pages are render targets, which some renderers lose on device resets.
+    class AtlasRepacker : public SpineObject {
+    public:
+        explicit AtlasRepacker(SDL_Renderer *renderer, int maxSize = 2048, int padding = 2);
+
+        // Destroys the shared pages, delete the skeletons drawn with them first
+        ~AtlasRepacker();
+
+        // Moves the regions of the atlases into new shared pages no larger than maxSize, keeping pma and straight
+        // alpha pages apart. Original pages left without regions have their texture released. Returns the number of
+        // shared pages created, 0 if the renderer can't render to textures.
+        int repack(Atlas **atlases, int count);
+
+        int getPageCount() const { return (int) pages.size(); };
+
+        // Texture switches in the skeleton's current draw order with the original pages minus with the shared ones
+        int countRemovedBatchBreaks(Skeleton &skeleton);
+
+    private:
+        struct MovedRegion {
+            AtlasRegion *region;
+            AtlasPage *from;
+        };
+
+        AtlasRepacker(const AtlasRepacker &);
+
+        AtlasRepacker &operator=(const AtlasRepacker &);
+
+        SDL_Renderer *renderer;
+        int maxSize;
+        int padding;
+        Vector<AtlasPage *> pages;
+        Vector<MovedRegion> moved;
+    };
+
+    class AssetCache;
+
+    // A SkeletonData with the Atlas and AnimationStateData it was loaded with, owned by an AssetCache
+    class SkeletonAsset : public SpineObject {
+    public:
+        SkeletonData *getSkeletonData() { return skeletonData; };
+
+        Atlas *getAtlas() { return atlas; };
+
+        AnimationStateData *getStateData() { return stateData; };
+
+        // Approximate bytes held: the atlas pages as 32-bit textures plus the mesh and animation data. Textures
+        // shared with other assets through the TextureRegistry are counted by each of them.
+        size_t getSize() const { return size; };
+
+        int getReferenceCount() const { return references; };
+
+        // A drawable sharing the asset's AnimationStateData, which keeps a reference until it is deleted
+        SkeletonDrawable *createDrawable();
+
+        void retain() { references++; };
+
+        // Unreferenced assets stay in the cache until its budget needs their memory
+        void release();
+
+    private:
+        friend class AssetCache;
+
+        SkeletonAsset();
+
+        ~SkeletonAsset();
+
+        void computeSize();
+
+        AssetCache *cache;
+        String skeletonPath;
+        String atlasPath;
+        float scale;
+        Atlas *atlas;
+        SkeletonData *skeletonData;
+        AnimationStateData *stateData;
+        size_t size;
+        int references;
+        Uint64 lastUsed;
+    };
+
+    // Loads skeletons once per file and scale and keeps them around while they're used. Assets that nothing
+    // references are evicted, the one released longest ago first, whenever the cache grows past its byte budget.
+    // Use it from one thread.
+    class AssetCache {
+    public:
+        explicit AssetCache(SDL_Renderer *renderer, size_t budget = 64 * 1024 * 1024);
+
+        // Deletes every asset, the drawables created from them must be gone by then
+        ~AssetCache();
+
+        // The asset with one more reference, loaded on a miss. .json files are read as JSON, anything else as
+        // binary. NULL if a file can't be read or parsed.
+        SkeletonAsset *acquire(const String &skeletonPath, const String &atlasPath, float scale = 1);
+
+        void setBudget(size_t bytes);
+
+        size_t getBudget() const { return budget; };
+
+        // Bytes held by every cached asset, referenced or not
+        size_t getSize() const { return size; };
+
+        int getAssetCount() const { return (int) assets.size(); };
+
+        // Evicts unreferenced assets, least recently used first, until the cache fits its budget
+        void trim();
+
+        // Evicts every unreferenced asset
+        void purge();
+
+    private:
+        friend class SkeletonAsset;
+
+        AssetCache(const AssetCache &);
+
+        AssetCache &operator=(const AssetCache &);
+
+        void evict(size_t index);
+
+        SDLTextureLoader textureLoader;
+        Vector<SkeletonAsset *> assets;
+        size_t budget;
+        size_t size;
+        Uint64 clock;
     };
 
 } /* namespace spine */
@@ -0,0 +1,156 @@
+//
+// Steven Burns 2022.
+//
+// Converts an .atlas, its page images and a .skel or .json into a single .spb bundle (see BundleHeader).
+//
+// usage: bundle <atlas> <skeleton> <output> [--native | pixel format name]
+//
+// The pages are stored as ARGB8888 unless --native picks the first 32-bit format with alpha of this machine's default
+// renderer, or another format is named (e.g. SDL_PIXELFORMAT_ABGR8888). Builds against either flavor's spine-sdl.h.
+//
+
+#include <spine/spine-sdl.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+static bool readFile(const string &path, vector<char> &data) {
+    SDL_RWops *file = SDL_RWFromFile(path.c_str(), "rb");
+    if (!file) return false;
+    Sint64 size = SDL_RWsize(file);
+    data.resize(size > 0 ? (size_t) size : 0);
+    bool ok = size >= 0 && SDL_RWread(file, data.data(), 1, data.size()) == data.size();
+    SDL_RWclose(file);
+    return ok;
+}
+
+// Page names as the spine atlas readers find them: the first line of every block separated by blank lines
+static vector<string> readPageNames(const vector<char> &atlas) {
+    vector<string> names;
+    bool pageNext = true;
+    size_t start = 0;
+    while (start < atlas.size()) {
+        size_t end = start;
+        while (end < atlas.size() && atlas[end] != '\n') end++;
+        string line(atlas.begin() + start, atlas.begin() + end);
+        start = end + 1;
+        size_t first = line.find_first_not_of(" \t\r");
+        if (first == string::npos) {
+            pageNext = true;
+            continue;
+        }
+        if (pageNext) names.push_back(line.substr(first, line.find_last_not_of(" \t\r") + 1 - first));
+        pageNext = false;
+    }
+    return names;
+}
+
+// The same rule as TextureOptions_NativeFormat: the renderer's first 32-bit format with alpha, else ARGB8888
+static Uint32 nativeFormat() {
+    Uint32 format = SDL_PIXELFORMAT_ARGB8888;
+    if (SDL_Init(SDL_INIT_VIDEO) != 0) return format;
+    SDL_Window *window = SDL_CreateWindow("bundle", 0, 0, 1, 1, SDL_WINDOW_HIDDEN);
+    SDL_Renderer *renderer = window ? SDL_CreateRenderer(window, -1, 0) : NULL;
+    SDL_RendererInfo info;
+    if (renderer && SDL_GetRendererInfo(renderer, &info) == 0) {
+        for (Uint32 i = 0; i < info.num_texture_formats; ++i) {
+            Uint32 candidate = info.texture_formats[i];
+            if (!SDL_ISPIXELFORMAT_FOURCC(candidate) && SDL_ISPIXELFORMAT_ALPHA(candidate) && SDL_BITSPERPIXEL(candidate) == 32) {
+                format = candidate;
+                break;
+            }
+        }
+    }
+    if (renderer) SDL_DestroyRenderer(renderer);
+    if (window) SDL_DestroyWindow(window);
+    SDL_Quit();
+    return format;
+}
+
+static Uint32 namedFormat(const char *name) {
+    static const Uint32 formats[] = {SDL_PIXELFORMAT_ARGB8888, SDL_PIXELFORMAT_ABGR8888, SDL_PIXELFORMAT_RGBA8888,
+                                     SDL_PIXELFORMAT_BGRA8888};
+    for (size_t i = 0; i < sizeof(formats) / sizeof(formats[0]); ++i)
+        if (strcmp(SDL_GetPixelFormatName(formats[i]), name) == 0) return formats[i];
+    return SDL_PIXELFORMAT_UNKNOWN;
+}
+
+static void put32(vector<char> &out, size_t offset, Uint32 value) {
+    value = SDL_SwapLE32(value);
+    memcpy(&out[offset], &value, 4);
+}
+
+int main(int argc, char **argv) {
+    if (argc < 4) {
+        printf("usage: %s <atlas> <skeleton> <output> [--native | pixel format name]\n", argv[0]);
+        return 1;
+    }
+    string atlasPath = argv[1], skeletonPath = argv[2];
+    Uint32 format = SDL_PIXELFORMAT_ARGB8888;
+    if (argc > 4) format = strcmp(argv[4], "--native") == 0 ? nativeFormat() : namedFormat(argv[4]);
+    if (format == SDL_PIXELFORMAT_UNKNOWN) {
+        printf("Unknown pixel format\n");
+        return 1;
+    }
+
+    vector<char> atlas, skeleton;
+    if (!readFile(atlasPath, atlas) || !readFile(skeletonPath, skeleton)) {
+        printf("Couldn't read %s or %s\n", atlasPath.c_str(), skeletonPath.c_str());
+        return 1;
+    }
+    vector<string> pageNames = readPageNames(atlas);
+    size_t slash = atlasPath.find_last_of("/\\");
+    string dir = slash == string::npos ? "" : atlasPath.substr(0, slash + 1);
+    bool isJson = skeletonPath.size() > 5 && skeletonPath.compare(skeletonPath.size() - 5, 5, ".json") == 0;
+
+    // Header and page table first, the sections follow in the order the loader reads them
+    vector<char> out(sizeof(spine::BundleHeader) + pageNames.size() * sizeof(spine::BundlePage), 0);
+    memcpy(&out[0], "SPB1", 4);
+    put32(out, offsetof(spine::BundleHeader, version), spine::BUNDLE_VERSION);
+    put32(out, offsetof(spine::BundleHeader, pixelFormat), format);
+    put32(out, offsetof(spine::BundleHeader, pageCount), (Uint32) pageNames.size());
+    put32(out, offsetof(spine::BundleHeader, atlasOffset), (Uint32) out.size());
+    put32(out, offsetof(spine::BundleHeader, atlasLength), (Uint32) atlas.size());
+    out.insert(out.end(), atlas.begin(), atlas.end());
+
+    for (size_t i = 0; i < pageNames.size(); ++i) {
+        string imagePath = dir + pageNames[i];
+        SDL_Surface *image = IMG_Load(imagePath.c_str());
+        SDL_Surface *converted = image ? SDL_ConvertSurfaceFormat(image, format, 0) : NULL;
+        if (image) SDL_FreeSurface(image);
+        if (!converted) {
+            printf("Couldn't load %s: %s\n", imagePath.c_str(), SDL_GetError());
+            return 1;
+        }
+        size_t entry = sizeof(spine::BundleHeader) + i * sizeof(spine::BundlePage);
+        put32(out, entry + offsetof(spine::BundlePage, width), (Uint32) converted->w);
+        put32(out, entry + offsetof(spine::BundlePage, height), (Uint32) converted->h);
+        put32(out, entry + offsetof(spine::BundlePage, pitch), (Uint32) converted->pitch);
+        put32(out, entry + offsetof(spine::BundlePage, pixelsOffset), (Uint32) out.size());
+        SDL_LockSurface(converted);
+        const char *pixels = (const char *) converted->pixels;
+        out.insert(out.end(), pixels, pixels + (size_t) converted->pitch * converted->h);
+        SDL_UnlockSurface(converted);
+        SDL_FreeSurface(converted);
+    }
+
+    put32(out, offsetof(spine::BundleHeader, skeletonOffset), (Uint32) out.size());
+    put32(out, offsetof(spine::BundleHeader, skeletonLength), (Uint32) skeleton.size());
+    put32(out, offsetof(spine::BundleHeader, skeletonIsJson), isJson ? 1 : 0);
+    out.insert(out.end(), skeleton.begin(), skeleton.end());
+    out.push_back('\0');
+
+    SDL_RWops *file = SDL_RWFromFile(argv[3], "wb");
+    if (!file || SDL_RWwrite(file, out.data(), 1, out.size()) != out.size()) {
+        printf("Couldn't write %s\n", argv[3]);
+        if (file) SDL_RWclose(file);
+        return 1;
+    }
+    SDL_RWclose(file);
+    printf("%s: %d pages in %s, %d bytes\n", argv[3], (int) pageNames.size(), SDL_GetPixelFormatName(format), (int) out.size());
+    return 0;
+}